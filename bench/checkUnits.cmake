@@ -0,0 +1,64 @@
+# @file checkUnits.cmake
+#
+# Measures of srcfacts by unit. The NDJSON records of the units must sum to
+# the measures of the report. The characters and LOC of the report also hold
+# the text of the archive between the units, so the records may sum to less.
+# A run that takes every unit from the cache must report the same measures
+# as a run that parses them.
+#
+# cmake -DSRCFACTS=path -DINPUT=file -DCACHE=file -P checkUnits.cmake
+
+# Run srcfacts with the arguments, with its output in the variable
+function(run_srcfacts VARIABLE)
+    execute_process(COMMAND ${SRCFACTS} ${ARGN}
+        OUTPUT_VARIABLE OUTPUT
+        ERROR_VARIABLE ERROR
+        RESULT_VARIABLE RESULT
+    )
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "check units : srcfacts ${ARGN} failed\n${ERROR}")
+    endif()
+    set(${VARIABLE} "${OUTPUT}" PARENT_SCOPE)
+endfunction()
+
+run_srcfacts(REPORT ${INPUT})
+
+# each measure of the report against the sum of its NDJSON member
+run_srcfacts(RECORDS --ndjson ${INPUT})
+string(REGEX REPLACE "\n$" "" RECORDS "${RECORDS}")
+string(REPLACE "\n" ";" RECORDS "${RECORDS}")
+list(LENGTH RECORDS FILES)
+foreach(MEASURE Characters LOC Classes Functions Declarations Expressions Comments Files)
+    string(TOLOWER ${MEASURE} MEMBER)
+    set(TOTAL 0)
+    if (MEASURE STREQUAL "Files")
+        set(TOTAL ${FILES})
+    else()
+        foreach(RECORD ${RECORDS})
+            string(JSON VALUE GET "${RECORD}" ${MEMBER})
+            math(EXPR TOTAL "${TOTAL} + ${VALUE}")
+        endforeach()
+    endif()
+    if (NOT REPORT MATCHES "\\| ${MEASURE} +\\| +([0-9]+) \\|")
+        message(FATAL_ERROR "check units : ${MEASURE} missing from the report")
+    endif()
+    set(REPORTED ${CMAKE_MATCH_1})
+    if (MEASURE MATCHES "Characters|LOC" AND NOT REPORTED LESS TOTAL)
+        message(STATUS "${MEASURE}: ${TOTAL} in units of ${REPORTED}")
+    elseif (NOT REPORTED EQUAL TOTAL)
+        message(SEND_ERROR "check units : ${MEASURE} is ${REPORTED}, but the NDJSON records sum to ${TOTAL}")
+    else()
+        message(STATUS "${MEASURE}: ${TOTAL}")
+    endif()
+endforeach()
+
+# the first run fills the cache, and the second takes every unit from it
+file(REMOVE ${CACHE})
+foreach(RUN filled reused)
+    run_srcfacts(OUTPUT --cache=${CACHE} ${INPUT})
+    if (NOT OUTPUT STREQUAL REPORT)
+        message(SEND_ERROR "check units : report with the ${RUN} cache differs\n${OUTPUT}\nwithout the cache:\n${REPORT}")
+    else()
+        message(STATUS "${RUN} cache: same report")
+    endif()
+endforeach()
@@ -0,0 +1,89 @@
+# @file compareEngines.cmake
+#
+# Output of srcfacts on each input engine, from a pipe, and parsed in
+# parallel, compared with its output on mapped input. The engines refill
+# the content at different offsets, so this holds tokens that are resumed
+# across refills, and the parallel parsers split the input at units or at
+# arbitrary offsets. With COMPRESS, the input is compressed with gzip or zip
+# first, and a truncated copy of the compressed input must fail.
+#
+# cmake -DSRCFACTS=path -DINPUT=file [-DOPTIONS=options] [-DCOMPRESS=gzip|zip]
+#       -P compareEngines.cmake
+
+# Run srcfacts with the arguments, with its output in the variable
+function(run_srcfacts VARIABLE)
+    execute_process(COMMAND ${SRCFACTS} ${OPTIONS} ${ARGN}
+        OUTPUT_VARIABLE OUTPUT
+        ERROR_VARIABLE ERROR
+        RESULT_VARIABLE RESULT
+    )
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "compare engines : srcfacts ${OPTIONS} ${ARGN} failed\n${ERROR}")
+    endif()
+    set(${VARIABLE} "${OUTPUT}" PARENT_SCOPE)
+endfunction()
+
+# Compare the output with the output on mapped input
+function(compare_output NAME OUTPUT)
+    if (NOT OUTPUT STREQUAL EXPECTED)
+        message(SEND_ERROR "compare engines : ${NAME} differs from mmap\n${OUTPUT}\nmmap:\n${EXPECTED}")
+    else()
+        message(STATUS "${NAME}: same as mmap")
+    endif()
+endfunction()
+
+separate_arguments(OPTIONS)
+run_srcfacts(EXPECTED --engine=mmap ${INPUT})
+
+set(SOURCE ${INPUT})
+if (COMPRESS STREQUAL "gzip")
+    set(SOURCE ${INPUT}.gz)
+    file(ARCHIVE_CREATE OUTPUT ${SOURCE} PATHS ${INPUT} FORMAT raw COMPRESSION GZip)
+elseif (COMPRESS STREQUAL "zip")
+    set(SOURCE ${INPUT}.zip)
+    get_filename_component(DIRECTORY ${INPUT} DIRECTORY)
+    get_filename_component(NAME ${INPUT} NAME)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E tar cf ${SOURCE} --format=zip ${NAME}
+        WORKING_DIRECTORY ${DIRECTORY}
+    )
+endif()
+
+foreach(ENGINE mmap thread uring ring)
+    run_srcfacts(OUTPUT --engine=${ENGINE} ${SOURCE})
+    compare_output(${ENGINE} "${OUTPUT}")
+endforeach()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E cat ${SOURCE}
+    COMMAND ${SRCFACTS} ${OPTIONS}
+    OUTPUT_VARIABLE OUTPUT
+    ERROR_VARIABLE ERROR
+    RESULTS_VARIABLE RESULTS
+)
+if (NOT RESULTS STREQUAL "0;0")
+    message(FATAL_ERROR "compare engines : srcfacts ${OPTIONS} on a pipe failed\n${ERROR}")
+endif()
+compare_output(pipe "${OUTPUT}")
+
+run_srcfacts(OUTPUT --jobs=4 ${SOURCE})
+compare_output(--jobs=4 "${OUTPUT}")
+run_srcfacts(OUTPUT --jobs=4 --speculative ${SOURCE})
+compare_output("--jobs=4 --speculative" "${OUTPUT}")
+
+# the end of the compressed stream is missing
+if (COMPRESS)
+    file(SIZE ${SOURCE} SIZE)
+    math(EXPR SIZE "${SIZE} / 2")
+    execute_process(COMMAND head -c ${SIZE} ${SOURCE} OUTPUT_FILE ${SOURCE}.truncated)
+    foreach(ENGINE mmap thread)
+        execute_process(COMMAND ${SRCFACTS} ${OPTIONS} --engine=${ENGINE} ${SOURCE}.truncated
+            OUTPUT_QUIET
+            ERROR_QUIET
+            RESULT_VARIABLE RESULT
+        )
+        if (RESULT EQUAL 0)
+            message(SEND_ERROR "compare engines : truncated ${COMPRESS} input on ${ENGINE} did not fail")
+        else()
+            message(STATUS "truncated ${COMPRESS} on ${ENGINE}: failed")
+        endif()
+    endforeach()
+endif()
@@ -0,0 +1,48 @@
+/*
+    generateCorpus.cpp
+
+    Command-line generator of a synthetic srcML archive, for benchmarks
+    of srcfacts without downloading large input.
+*/
+
+#include "srcMLGenerator.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+
+    CorpusOptions options;
+    std::string path;
+    for (int arg = 1; arg < argc; ++arg) {
+        const std::string option(argv[arg]);
+        if (parseCorpusOption(option, options))
+            continue;
+        if (option.empty() || option[0] == '-' || !path.empty()) {
+            std::cerr << "usage: srcmlgen [--size=N[K|M|G]] [--tags=N] [--depth=N] [--attributes=N] [--comments=percent] "
+                         "[--cdata=percent] [--unit-size=N] [--seed=N] [file]\n";
+            return 1;
+        }
+        path = option;
+    }
+
+    // srcML to a file, or to standard output
+    std::ofstream file;
+    if (!path.empty()) {
+        file.open(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "srcmlgen : Unable to create file " << path << '\n';
+            return 1;
+        }
+    }
+    std::ostream& output = path.empty() ? std::cout : file;
+    const auto lines = generateCorpus(options, output);
+    output.flush();
+    if (!output) {
+        std::cerr << "srcmlgen : Unable to write srcML\n";
+        return 1;
+    }
+    std::clog << corpusName(options) << ": " << lines << " lines\n";
+
+    return 0;
+}
@@ -0,0 +1,375 @@
+/*
+    kernelBenchmark.cpp
+
+    Micro-benchmarks for the scanning kernels of srcFacts.
+
+    Character classification: the constexpr CHARACTER_CLASS table compared
+    to the std::bitset<128> xmlNameMask it replaced. Input is a fixed
+    pseudorandom mix of name characters, delimiters, whitespace, and UTF-8
+    bytes, as in the attributes of srcML.
+
+    Scanning kernels: each kernel is called at the positions where the
+    parser calls it in srcML, i.e., generated srcML or a srcML file given
+    as the argument, and reported in cycles per byte scanned. Cycles are
+    core cycles from the performance counters when available, otherwise
+    the time stamp counter on x86. With --json, only the median throughput
+    of each scanning kernel is output, in KB/s, for the performance gate.
+*/
+
+#include "scanContent.hpp"
+#include "perfCounters.hpp"
+#include "srcMLGenerator.hpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <bitset>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+    const std::bitset<128> xmlNameMask("00000111111111111111111111111110100001111111111111111111111111100000001111111111011000000000000000000000000000000000000000000000");
+
+    /*
+        Generate the benchmark input with a fixed linear congruential generator.
+
+        @param[in] size Number of bytes
+        @return Input bytes
+    */
+    std::string generateInput(std::size_t size) {
+
+        constexpr std::string_view alphabet = "abcdefghijklmnopqrstuvwxyz_:-.0123456789=\" \n\t>/\xc3\xa9"sv;
+        std::string input(size, ' ');
+        std::uint32_t state = 12345;
+        for (auto& c : input) {
+            state = state * 1664525 + 1013904223;
+            c = alphabet[(state >> 16) % alphabet.size()];
+        }
+
+        return input;
+    }
+
+    /*
+        Time a classifier over the input.
+
+        @param[in] label Name of the classifier
+        @param[in] input Input bytes
+        @param[in] repeats Number of passes over the input
+        @param[in] classify Classifier of a single character
+        @return Nanoseconds per byte
+    */
+    template <typename Classify>
+    double timeClassifier(std::string_view label, std::string_view input, int repeats, Classify classify) {
+
+        std::size_t count = 0;
+        const auto startTime = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < repeats; ++repeat) {
+            for (const char c : input)
+                count += classify(c);
+#if defined(__GNUC__) || defined(__clang__)
+            // keep each pass from being folded into the others
+            asm volatile("" : "+r"(count));
+#endif
+        }
+        const auto finishTime = std::chrono::steady_clock::now();
+        const double nanoseconds = std::chrono::duration<double, std::nano>(finishTime - startTime).count();
+        const double perByte = nanoseconds / (static_cast<double>(input.size()) * repeats);
+        std::cout << "| " << std::setw(16) << std::left << label << " | " << std::setw(10) << std::right << perByte
+                  << " | " << std::setw(12) << count / repeats << " |\n";
+
+        return perByte;
+    }
+
+    // positions in srcML where the parser calls each kernel
+    struct KernelPositions {
+        std::vector<std::size_t> nameStarts;
+        std::vector<std::size_t> whitespaceStarts;
+        std::vector<std::size_t> characterStarts;
+        std::vector<std::size_t> valueStarts;
+        std::vector<std::size_t> commentStarts;
+    };
+
+    /*
+        Find the positions of the kernels in srcML with a scalar scan. The
+        text of comment elements is appended to the comments as XML
+        comments, for the search of the comment terminator.
+
+        @param[in] srcML View of the srcML
+        @param[out] positions Positions of the kernels in the srcML
+        @param[out] comments XML comments
+    */
+    void findKernelPositions(std::string_view srcML, KernelPositions& positions, std::string& comments) {
+
+        std::size_t pos = 0;
+        while (pos < srcML.size()) {
+            if (srcML[pos] == '&') {
+                pos = srcML.find(';', pos);
+                pos = pos == srcML.npos ? srcML.size() : pos + 1;
+            } else if (srcML[pos] != '<') {
+                positions.characterStarts.push_back(pos);
+                pos = srcML.find_first_of("<&"sv, pos);
+                pos = pos == srcML.npos ? srcML.size() : pos;
+            } else if (srcML.compare(pos, "<![CDATA["sv.size(), "<![CDATA["sv) == 0) {
+                pos = srcML.find("]]>"sv, pos);
+                pos = pos == srcML.npos ? srcML.size() : pos + "]]>"sv.size();
+            } else if (srcML[pos + 1] == '?' || srcML[pos + 1] == '!') {
+                pos = srcML.find('>', pos);
+                pos = pos == srcML.npos ? srcML.size() : pos + 1;
+            } else {
+                // tag name, whitespace after it, and after each attribute value
+                pos += srcML[pos + 1] == '/' ? 2 : 1;
+                positions.nameStarts.push_back(pos);
+                const std::size_t nameStart = pos;
+                pos = srcML.find_first_of(NAMEEND, pos);
+                if (pos == srcML.npos)
+                    break;
+                if (srcML[pos] == ':')
+                    pos = srcML.find_first_of(NAMEEND, pos + 1);
+                const bool commentElement = srcML.compare(nameStart, pos - nameStart, "comment"sv) == 0;
+                positions.whitespaceStarts.push_back(pos);
+                while (pos < srcML.size() && srcML[pos] != '>') {
+                    if (srcML[pos] == '"') {
+                        positions.valueStarts.push_back(pos + 1);
+                        pos = srcML.find('"', pos + 1);
+                        if (pos == srcML.npos)
+                            break;
+                        positions.whitespaceStarts.push_back(pos + 1);
+                    }
+                    ++pos;
+                }
+                if (pos >= srcML.size())
+                    break;
+                ++pos;
+                if (commentElement) {
+                    const std::size_t commentEnd = srcML.find('<', pos);
+                    comments += "<!--"sv;
+                    positions.commentStarts.push_back(comments.size());
+                    comments += srcML.substr(pos, commentEnd - pos);
+                    comments += "-->"sv;
+                }
+            }
+        }
+    }
+
+    // cycles, i.e., core cycles when counted, otherwise the time stamp counter
+    std::uint64_t cycles(bool coreCycles) {
+
+        if (coreCycles) {
+            PerfCounts run;
+            PerfCounts wait;
+            readPerfCounters(run, wait);
+            return run.values[CYCLES];
+        }
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    // timing of a kernel over its positions
+    struct KernelTime {
+        std::string_view label;
+        std::size_t calls = 0;
+        double bytesPerCall = 0;
+        double nanosecondsPerByte = 0;
+        // 0 when there is no cycle counter
+        double cyclesPerByte = 0;
+        double medianMegabytesPerSecond = 0;
+    };
+
+    /*
+        Time a kernel over its positions in srcML.
+
+        @param[in] label Name of the kernel
+        @param[in] calls Number of calls of a pass
+        @param[in] repeats Number of passes
+        @param[in] coreCycles Cycles are core cycles
+        @param[in] pass Calls of the kernel at all positions, returning the bytes scanned
+        @return Timing of the kernel
+    */
+    template <typename Pass>
+    KernelTime timeKernel(std::string_view label, std::size_t calls, int repeats, bool coreCycles, Pass pass) {
+
+        std::size_t bytes = 0;
+        std::vector<double> megabytesPerSecond;
+        double nanoseconds = 0;
+        const std::uint64_t startCycles = cycles(coreCycles);
+        for (int repeat = 0; repeat < repeats; ++repeat) {
+            const auto startTime = std::chrono::steady_clock::now();
+            const std::size_t passBytes = pass();
+            const auto finishTime = std::chrono::steady_clock::now();
+            bytes += passBytes;
+#if defined(__GNUC__) || defined(__clang__)
+            asm volatile("" : "+r"(bytes));
+#endif
+            const double passNanoseconds = std::chrono::duration<double, std::nano>(finishTime - startTime).count();
+            nanoseconds += passNanoseconds;
+            megabytesPerSecond.push_back(1e3 * static_cast<double>(passBytes) / std::max(passNanoseconds, 1.0));
+        }
+        const std::uint64_t finishCycles = cycles(coreCycles);
+        std::sort(megabytesPerSecond.begin(), megabytesPerSecond.end());
+        const double totalBytes = static_cast<double>(std::max<std::size_t>(bytes, 1));
+
+        KernelTime time;
+        time.label = label;
+        time.calls = calls;
+        time.bytesPerCall = totalBytes / repeats / static_cast<double>(std::max<std::size_t>(calls, 1));
+        time.nanosecondsPerByte = nanoseconds / totalBytes;
+        time.cyclesPerByte = static_cast<double>(finishCycles - startCycles) / totalBytes;
+        time.medianMegabytesPerSecond = megabytesPerSecond[megabytesPerSecond.size() / 2];
+
+        return time;
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    bool json = false;
+    std::string path;
+    for (int arg = 1; arg < argc; ++arg) {
+        const std::string option(argv[arg]);
+        if (option == "--json") {
+            json = true;
+        } else if (option.empty() || option[0] == '-' || !path.empty()) {
+            std::cerr << "usage: kernelbench [--json] [file]\n";
+            return 1;
+        } else {
+            path = option;
+        }
+    }
+
+    const int repeats = 8;
+    std::cout << std::fixed << std::setprecision(4);
+    if (!json) {
+        // character classification
+        const std::string input = generateInput(16 * 1024 * 1024);
+        std::cout << "| Classifier       |    ns/byte |   Name chars |\n";
+        std::cout << "|:-----------------|-----------:|-------------:|\n";
+        // the bitset requires a range check, since bytes >= 128 are outside of it
+        const double bitsetTime = timeClassifier("bitset<128>", input, repeats, [](char c) {
+            const auto u = static_cast<unsigned char>(c);
+            return u < 128 && xmlNameMask[u];
+        });
+        const double tableTime = timeClassifier("CHARACTER_CLASS", input, repeats, [](char c) {
+            return isCharacterClass(c, NAME_CHAR);
+        });
+        std::cout << "\nSpeedup: " << std::setprecision(2) << bitsetTime / tableTime << "x\n";
+    }
+
+    // srcML of the argument, otherwise generated, with room after it for the lookahead of the kernels
+    std::string srcML;
+    if (!path.empty()) {
+        std::ifstream file(path, std::ios::binary);
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        srcML = contents.str();
+        if (!file) {
+            std::cerr << "kernelbench : Unable to read file " << path << '\n';
+            return 1;
+        }
+    } else {
+        CorpusOptions options;
+        options.size = 16 * 1024 * 1024;
+        options.attributes = 2;
+        std::ostringstream generated;
+        generateCorpus(options, generated);
+        srcML = generated.str();
+    }
+    KernelPositions positions;
+    std::string comments;
+    findKernelPositions(srcML, positions, comments);
+    const std::size_t srcMLSize = srcML.size();
+    const std::size_t commentsSize = comments.size();
+    srcML.append(4096, '\0');
+    comments.append(4096, '\0');
+    const std::string_view content(srcML.data(), srcMLSize);
+    const std::string_view commentContent(comments.data(), commentsSize);
+
+    const bool coreCycles = startPerfCounters() > 0 && [] {
+        PerfCounts run;
+        PerfCounts wait;
+        readPerfCounters(run, wait);
+        return run.available[CYCLES];
+    }();
+    std::vector<KernelTime> times;
+    times.push_back(timeKernel("whitespace skip", positions.whitespaceStarts.size(), repeats, coreCycles, [&] {
+        std::size_t bytes = 0;
+        for (const auto pos : positions.whitespaceStarts)
+            bytes += std::min(findNonWhitespace(content.substr(pos)), content.size() - pos) + 1;
+        return bytes;
+    }));
+    times.push_back(timeKernel("NAMEEND search", positions.nameStarts.size(), repeats, coreCycles, [&] {
+        std::size_t bytes = 0;
+        for (const auto pos : positions.nameStarts)
+            bytes += std::min(findNameEnd(content.substr(pos)), content.size() - pos) + 1;
+        return bytes;
+    }));
+    times.push_back(timeKernel("'<&' search", positions.characterStarts.size(), repeats, coreCycles, [&] {
+        std::size_t bytes = 0;
+        int newlines = 0;
+        for (const auto pos : positions.characterStarts)
+            bytes += std::min(findCharactersEnd(content.substr(pos), newlines), content.size() - pos) + 1;
+        return bytes + (newlines & 1);
+    }));
+    times.push_back(timeKernel("newline count", positions.characterStarts.size(), repeats, coreCycles, [&] {
+        std::size_t bytes = 0;
+        int newlines = 0;
+        for (const auto pos : positions.characterStarts) {
+            const std::size_t end = std::min(content.find_first_of("<&"sv, pos), content.size());
+            newlines += countNewlines(content.substr(pos, end - pos));
+            bytes += end - pos;
+        }
+        return bytes + (newlines & 1);
+    }));
+    times.push_back(timeKernel("attribute value scan", positions.valueStarts.size(), repeats, coreCycles, [&] {
+        std::size_t bytes = 0;
+        for (const auto pos : positions.valueStarts)
+            bytes += std::min(content.substr(pos).find('"'), content.size() - pos) + 1;
+        return bytes;
+    }));
+    times.push_back(timeKernel("comment terminator", positions.commentStarts.size(), repeats, coreCycles, [&] {
+        std::size_t bytes = 0;
+        for (const auto pos : positions.commentStarts)
+            bytes += std::min(commentContent.substr(pos).find("-->"sv), commentContent.size() - pos) + "-->"sv.size();
+        return bytes;
+    }));
+
+    if (json) {
+        std::cout << std::setprecision(0) << "{\n  \"kernels\": {\n";
+        for (std::size_t kernel = 0; kernel < times.size(); ++kernel) {
+            std::cout << "    \"" << times[kernel].label << "\": " << 1e3 * times[kernel].medianMegabytesPerSecond
+                      << (kernel + 1 < times.size() ? ",\n" : "\n");
+        }
+        std::cout << "  }\n}\n";
+        return 0;
+    }
+    std::cout << "\n" << srcMLSize << " bytes of srcML, cycles from " << (coreCycles ? "core cycle counter" : "time stamp counter") << "\n\n";
+    std::cout << "| Kernel                 |      Calls | Bytes/call |  ns/byte | Cycles/byte | Median MB/s |\n";
+    std::cout << "|:-----------------------|-----------:|-----------:|---------:|------------:|------------:|\n";
+    for (const auto& time : times) {
+        std::cout << "| " << std::setw(22) << std::left << time.label << std::right
+                  << " | " << std::setw(10) << time.calls
+                  << " | " << std::setw(10) << std::setprecision(1) << time.bytesPerCall
+                  << " | " << std::setw(8) << std::setprecision(3) << time.nanosecondsPerByte
+                  << " | " << std::setw(11);
+        if (time.cyclesPerByte > 0)
+            std::cout << time.cyclesPerByte;
+        else
+            std::cout << "-";
+        std::cout << " | " << std::setw(11) << std::setprecision(0) << time.medianMegabytesPerSecond << " |\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+# @file perfGate.cmake
+#
+# Performance regression gate. Runs the scanning kernel micro-benchmarks and
+# the srcfacts benchmarks, and compares the median throughput of each kernel
+# and corpus with the checked-in baseline. Fails when any of them regresses
+# by more than THRESHOLD percent. With UPDATE, the baseline is replaced by
+# the measured throughput instead.
+#
+# The baseline is in KB/s, so it only holds for the machine it was measured
+# on. On any other machine, regenerate it first with make perf_baseline.
+# The demo input, INPUT, is compressed, so the gate also holds the zip path.
+# It is small, so srcfactsbench gives it to one run of srcfacts enough times
+# to reach SIZE, and process startup does not dominate its time.
+#
+# cmake -DKERNELBENCH=path -DSRCFACTSBENCH=path -DSRCFACTS=path -DCORPUS=directory
+#       -DSIZE=size -DREPETITIONS=N -DINPUT=file -DBASELINE=file -DTHRESHOLD=percent
+#       [-DUPDATE=ON] -P perfGate.cmake
+
+# Run a benchmark, with the JSON of its median throughput in the variable
+function(run_benchmark VARIABLE)
+    execute_process(COMMAND ${ARGN} --json
+        OUTPUT_VARIABLE OUTPUT
+        RESULT_VARIABLE RESULT
+    )
+    if (NOT RESULT EQUAL 0)
+        message(FATAL_ERROR "perf gate : ${ARGV1} failed")
+    endif()
+    set(${VARIABLE} "${OUTPUT}" PARENT_SCOPE)
+endfunction()
+
+run_benchmark(KERNELS ${KERNELBENCH})
+run_benchmark(CORPORA ${SRCFACTSBENCH} --srcfacts=${SRCFACTS} --corpus=${CORPUS}
+              --size=${SIZE} --repetitions=${REPETITIONS} --input=${INPUT})
+
+# one object with both sections, in the format of the benchmarks
+string(REGEX REPLACE "}[ \n]*$" "" KERNELS "${KERNELS}")
+string(REGEX REPLACE "^[ \n]*{" "" CORPORA "${CORPORA}")
+string(REGEX REPLACE "[ \n]+$" "" KERNELS "${KERNELS}")
+set(MEASURED "${KERNELS},${CORPORA}")
+
+if (UPDATE)
+    file(WRITE ${BASELINE} "${MEASURED}")
+    message(STATUS "Baseline written to ${BASELINE}")
+    return()
+endif()
+
+# each kernel and corpus of the baseline against its measured median throughput, in KB/s
+file(READ ${BASELINE} EXPECTED)
+set(REGRESSIONS 0)
+foreach(SECTION kernels srcfacts)
+    string(JSON COUNT LENGTH "${EXPECTED}" ${SECTION})
+    math(EXPR LAST "${COUNT} - 1")
+    foreach(INDEX RANGE ${LAST})
+        string(JSON NAME MEMBER "${EXPECTED}" ${SECTION} ${INDEX})
+        string(JSON BASE GET "${EXPECTED}" ${SECTION} ${NAME})
+        string(JSON CURRENT ERROR_VARIABLE MISSING GET "${MEASURED}" ${SECTION} ${NAME})
+        if (MISSING)
+            message(SEND_ERROR "${SECTION} ${NAME}: not measured")
+            math(EXPR REGRESSIONS "${REGRESSIONS} + 1")
+            continue()
+        endif()
+        math(EXPR CURRENT_SCALED "${CURRENT} * 100")
+        math(EXPR LIMIT_SCALED "${BASE} * (100 - ${THRESHOLD})")
+        if (CURRENT_SCALED LESS LIMIT_SCALED)
+            message(SEND_ERROR "${SECTION} ${NAME}: ${CURRENT} KB/s, regressed more than ${THRESHOLD}% from ${BASE} KB/s")
+            math(EXPR REGRESSIONS "${REGRESSIONS} + 1")
+        else()
+            message(STATUS "${SECTION} ${NAME}: ${CURRENT} KB/s, baseline ${BASE} KB/s")
+        endif()
+    endforeach()
+endforeach()
+if (REGRESSIONS GREATER 0)
+    message(FATAL_ERROR "perf gate : ${REGRESSIONS} regressions")
+endif()
@@ -0,0 +1,281 @@
+/*
+    srcFactsBenchmark.cpp
+
+    Benchmark harness of srcfacts over a matrix of generated srcML corpora.
+
+    Each corpus is generated once into the corpus directory, and reused by
+    later runs. srcfacts is run on each corpus for a number of repetitions,
+    after a warm-up run, and the throughput is reported in GB/s and MLOC/s,
+    with the mean, standard deviation, and median across the repetitions.
+    The time is the wall-clock time of the srcfacts process.
+
+    Existing srcML files, e.g., demo.xml.zip, are added to the matrix with
+    --input. A file smaller than the corpus size is given to one srcfacts
+    run as many times as it takes to reach that size, parsed on one
+    thread, so that the time of process startup is amortized. With --json,
+    only the median throughput of each corpus is output, in KB/s, for the
+    performance gate.
+*/
+
+#include "srcMLGenerator.hpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+    // most copies of an existing file in one run
+    const std::uint64_t MAX_COPIES = 1000;
+
+    // corpus of the matrix
+    struct Corpus {
+        std::string name;
+        CorpusOptions options;
+        // existing file, instead of a generated corpus
+        std::string path;
+    };
+
+    // result of a run of srcfacts
+    struct Run {
+        double seconds = 0;
+        long loc = 0;
+        // bytes of the input, after any decompression
+        long bytes = 0;
+    };
+
+    /*
+        Run srcfacts on a file, with its report captured
+
+        @param[in] srcfacts Path of srcfacts
+        @param[in] arguments Options of srcfacts
+        @param[in] path Path of the input file
+        @param[in] copies Number of times the file is given to srcfacts
+        @param[out] run Time, LOC, and bytes of the run
+        @return Status
+        @retval 0 Success
+        @retval -1 srcfacts failed, with the message on standard error
+    */
+    int runSrcFacts(const std::string& srcfacts, const std::vector<std::string>& arguments, const std::string& path, int copies, Run& run) {
+
+        int output[2];
+        if (pipe(output) != 0)
+            return -1;
+        const auto startTime = std::chrono::steady_clock::now();
+        const pid_t pid = fork();
+        if (pid == 0) {
+            dup2(output[1], 1);
+            dup2(output[1], 2);
+            close(output[0]);
+            close(output[1]);
+            std::vector<char*> argv{ const_cast<char*>(srcfacts.c_str()) };
+            static char singleJob[] = "--jobs=1";
+            if (copies > 1)
+                argv.push_back(singleJob);
+            for (const auto& argument : arguments)
+                argv.push_back(const_cast<char*>(argument.c_str()));
+            for (int copy = 0; copy < copies; ++copy)
+                argv.push_back(const_cast<char*>(path.c_str()));
+            argv.push_back(nullptr);
+            execv(srcfacts.c_str(), argv.data());
+            _exit(127);
+        }
+        close(output[1]);
+        std::string report;
+        char buffer[4096];
+        for (ssize_t bytes; (bytes = read(output[0], buffer, sizeof(buffer))) > 0; )
+            report.append(buffer, static_cast<std::size_t>(bytes));
+        close(output[0]);
+        int status = 0;
+        if (pid == -1 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "srcfactsbench : srcfacts failed on " << path << '\n';
+            return -1;
+        }
+        run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        // LOC of the report, or of the total of multiple files, with any digit grouping of the locale
+        const std::size_t locPosition = report.rfind("| LOC "sv);
+        run.loc = 0;
+        if (locPosition != report.npos) {
+            for (std::size_t pos = report.find('|', locPosition + 1) + 1; pos < report.size() && report[pos] != '\n'; ++pos) {
+                if (report[pos] >= '0' && report[pos] <= '9')
+                    run.loc = run.loc * 10 + (report[pos] - '0');
+            }
+        }
+
+        // bytes of the input, in the line of the bytes on standard error
+        run.bytes = 0;
+        const std::size_t bytesPosition = report.find(" bytes\n"sv);
+        if (bytesPosition != report.npos) {
+            for (std::size_t pos = report.rfind('\n', bytesPosition) + 1; pos < bytesPosition; ++pos) {
+                if (report[pos] >= '0' && report[pos] <= '9')
+                    run.bytes = run.bytes * 10 + (report[pos] - '0');
+            }
+        }
+
+        return 0;
+    }
+
+    // mean of values
+    double mean(const std::vector<double>& values) {
+
+        return std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+    }
+
+    // sample standard deviation of values
+    double standardDeviation(const std::vector<double>& values) {
+
+        if (values.size() < 2)
+            return 0;
+        const double average = mean(values);
+        double sum = 0;
+        for (const auto value : values)
+            sum += (value - average) * (value - average);
+
+        return std::sqrt(sum / static_cast<double>(values.size() - 1));
+    }
+
+    // median of values
+    double median(std::vector<double> values) {
+
+        std::sort(values.begin(), values.end());
+        const std::size_t middle = values.size() / 2;
+
+        return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string srcfacts;
+    std::string corpusDirectory = "bench-corpus";
+    int repetitions = 5;
+    CorpusOptions baseOptions;
+    bool corpusOptions = false;
+    bool json = false;
+    std::vector<std::string> inputs;
+    std::vector<std::string> arguments;
+    for (int arg = 1; arg < argc; ++arg) {
+        const std::string option(argv[arg]);
+        if (option == "--") {
+            arguments.assign(argv + arg + 1, argv + argc);
+            break;
+        } else if (option.compare(0, "--srcfacts="sv.size(), "--srcfacts="sv) == 0) {
+            srcfacts = option.substr("--srcfacts="sv.size());
+        } else if (option.compare(0, "--corpus="sv.size(), "--corpus="sv) == 0) {
+            corpusDirectory = option.substr("--corpus="sv.size());
+        } else if (option.compare(0, "--repetitions="sv.size(), "--repetitions="sv) == 0) {
+            repetitions = std::max(std::atoi(option.c_str() + "--repetitions="sv.size()), 1);
+        } else if (option.compare(0, "--input="sv.size(), "--input="sv) == 0) {
+            inputs.push_back(option.substr("--input="sv.size()));
+        } else if (option == "--json") {
+            json = true;
+        } else if (parseCorpusOption(option, baseOptions)) {
+            corpusOptions = corpusOptions || option.compare(0, "--size="sv.size(), "--size="sv) != 0;
+        } else {
+            srcfacts.clear();
+            break;
+        }
+    }
+    if (srcfacts.empty()) {
+        std::cerr << "usage: srcfactsbench --srcfacts=path [--corpus=directory] [--repetitions=N] [--size=N[K|M|G]] "
+                     "[corpus options] [--input=file]... [--json] [-- srcfacts options]\n";
+        return 1;
+    }
+
+    // matrix of corpora, or the single corpus of the corpus options
+    std::vector<Corpus> matrix;
+    const auto add = [&matrix, &baseOptions](std::string name, auto change) {
+        CorpusOptions options = baseOptions;
+        change(options);
+        matrix.push_back({ std::move(name), options, std::string() });
+    };
+    if (corpusOptions) {
+        add("custom", [](CorpusOptions&) {});
+    } else {
+        add("default", [](CorpusOptions&) {});
+        add("sparse tags", [](CorpusOptions& options) { options.tags = 3; });
+        add("dense tags", [](CorpusOptions& options) { options.tags = 16; });
+        add("deep", [](CorpusOptions& options) { options.tags = 16; options.depth = 16; });
+        add("attributes", [](CorpusOptions& options) { options.attributes = 3; });
+        add("comments", [](CorpusOptions& options) { options.comments = 40; });
+        add("CDATA", [](CorpusOptions& options) { options.cdata = 20; });
+    }
+    for (const auto& input : inputs)
+        matrix.push_back({ std::filesystem::path(input).filename().string(), baseOptions, input });
+
+    std::error_code error;
+    std::filesystem::create_directories(corpusDirectory, error);
+    std::cout << std::fixed;
+    if (json)
+        std::cout << "{\n  \"srcfacts\": {\n";
+    else
+        std::cout << "| Corpus       | Options                  |     MB |   GB/s |      ± | Median GB/s | MLOC/s |     ± |  CV % |\n";
+    if (!json)
+        std::cout << "|:-------------|:-------------------------|-------:|-------:|-------:|------------:|-------:|------:|------:|\n";
+    for (const auto& corpus : matrix) {
+
+        // generate the corpus once
+        const std::string path = !corpus.path.empty() ? corpus.path : corpusDirectory + "/" + corpusName(corpus.options) + ".xml";
+        if (corpus.path.empty() && !std::filesystem::exists(path, error)) {
+            std::ofstream file(path + ".tmp", std::ios::binary);
+            generateCorpus(corpus.options, file);
+            file.close();
+            if (!file) {
+                std::cerr << "srcfactsbench : Unable to write corpus " << path << '\n';
+                return 1;
+            }
+            std::filesystem::rename(path + ".tmp", path, error);
+        }
+        // warm-up run, then the timed repetitions, with enough copies of a small existing file
+        Run run;
+        int copies = 1;
+        if (runSrcFacts(srcfacts, arguments, path, copies, run) != 0)
+            return 1;
+        if (!corpus.path.empty() && run.bytes > 0 && static_cast<std::uint64_t>(run.bytes) < corpus.options.size) {
+            copies = static_cast<int>(std::min<std::uint64_t>((corpus.options.size + run.bytes - 1) / run.bytes, MAX_COPIES));
+            if (runSrcFacts(srcfacts, arguments, path, copies, run) != 0)
+                return 1;
+        }
+        const double bytes = static_cast<double>(run.bytes > 0 ? run.bytes : static_cast<long>(std::filesystem::file_size(path, error)));
+        std::vector<double> gigabytesPerSecond;
+        std::vector<double> mlocPerSecond;
+        for (int repetition = 0; repetition < repetitions; ++repetition) {
+            if (runSrcFacts(srcfacts, arguments, path, copies, run) != 0)
+                return 1;
+            gigabytesPerSecond.push_back(bytes / run.seconds / 1e9);
+            mlocPerSecond.push_back(static_cast<double>(run.loc) / run.seconds / 1e6);
+        }
+        if (json) {
+            std::cout << "    \"" << corpus.name << "\": " << std::setprecision(0) << 1e6 * median(gigabytesPerSecond)
+                      << (&corpus != &matrix.back() ? ",\n" : "\n");
+            continue;
+        }
+        const double meanThroughput = mean(gigabytesPerSecond);
+        std::cout << "| " << std::left << std::setw(12) << corpus.name << " | " << std::setw(24) << corpusName(corpus.options) << std::right
+                  << " | " << std::setw(6) << std::setprecision(1) << bytes / 1e6
+                  << " | " << std::setw(6) << std::setprecision(3) << meanThroughput
+                  << " | " << std::setw(6) << standardDeviation(gigabytesPerSecond)
+                  << " | " << std::setw(11) << median(gigabytesPerSecond)
+                  << " | " << std::setw(6) << std::setprecision(2) << mean(mlocPerSecond)
+                  << " | " << std::setw(5) << standardDeviation(mlocPerSecond)
+                  << " | " << std::setw(5) << std::setprecision(1) << 100 * standardDeviation(gigabytesPerSecond) / meanThroughput
+                  << " |\n" << std::flush;
+    }
+    if (json)
+        std::cout << "  }\n}\n";
+
+    return 0;
+}
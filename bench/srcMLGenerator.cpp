@@ -0,0 +1,260 @@
+/*
+    srcMLGenerator.cpp
+
+    Implementation of the deterministic generator of synthetic srcML.
+
+    Randomness is from splitmix64 with a fixed seed, and choices are made
+    with modulo, not with the standard distributions, whose results differ
+    between standard libraries.
+*/
+
+#include "srcMLGenerator.hpp"
+#include <algorithm>
+#include <string_view>
+#include <vector>
+#include <cstdlib>
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+    // generator of pseudorandom numbers
+    class Random {
+    public:
+        explicit Random(std::uint64_t seed) : state(seed) {}
+
+        // next number, splitmix64
+        std::uint64_t next() {
+
+            std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+            return z ^ (z >> 31);
+        }
+
+        // number in [0, limit)
+        int below(int limit) {
+
+            return static_cast<int>(next() % static_cast<std::uint64_t>(limit));
+        }
+
+        // element of a list
+        template <std::size_t size>
+        std::string_view pick(const std::string_view (&list)[size]) {
+
+            return list[below(static_cast<int>(size))];
+        }
+
+    private:
+        std::uint64_t state;
+    };
+
+    constexpr std::string_view STATEMENTS[] = { "expr_stmt"sv, "decl_stmt"sv, "return"sv, "if_stmt"sv };
+
+    constexpr std::string_view ELEMENTS[] = { "expr"sv, "name"sv, "name"sv, "name"sv, "operator"sv, "operator"sv, "call"sv,
+                                              "argument_list"sv, "argument"sv, "literal"sv, "decl"sv, "type"sv, "init"sv,
+                                              "index"sv, "condition"sv };
+
+    constexpr std::string_view ATTRIBUTES[] = { "type"sv, "pos:start"sv, "pos:end"sv, "ref"sv, "kind"sv };
+
+    // words of the text, with character entity references as in srcML
+    constexpr std::string_view WORDS[] = { "count"sv, "i"sv, "content"sv, "size"sv, "0"sv, "1"sv, "="sv, "+"sv, "-"sv,
+                                           "&lt;"sv, "&gt;"sv, "&amp;&amp;"sv, "-&gt;"sv, "("sv, ")"sv, ","sv, "."sv,
+                                           "std::string_view"sv, "nameEndPosition"sv, "\"text\""sv };
+
+    /*
+        Append the start tag of an element
+
+        @param[in, out] unit Text of the unit
+        @param[in] name Name of the element
+        @param[in] options Options of the corpus
+        @param[in, out] random Generator of pseudorandom numbers
+    */
+    void startTag(std::string& unit, std::string_view name, const CorpusOptions& options, Random& random) {
+
+        unit += '<';
+        unit += name;
+        for (int attribute = 0; attribute < options.attributes; ++attribute) {
+            unit += ' ';
+            unit += ATTRIBUTES[attribute % std::size(ATTRIBUTES)];
+            if (attribute >= static_cast<int>(std::size(ATTRIBUTES)))
+                unit += std::to_string(attribute);
+            unit += "=\"";
+            unit += std::to_string(random.below(1000));
+            unit += '"';
+        }
+        unit += '>';
+    }
+
+    /*
+        Append a line of code, with nested elements
+
+        @param[in, out] unit Text of the unit
+        @param[in] options Options of the corpus
+        @param[in, out] random Generator of pseudorandom numbers
+    */
+    void codeLine(std::string& unit, const CorpusOptions& options, Random& random) {
+
+        std::vector<std::string_view> open;
+        unit += "    ";
+        for (int element = 0; element < options.tags; ) {
+            if (static_cast<int>(open.size()) < std::max(options.depth, 1) && (open.empty() || random.below(2) == 0)) {
+                open.push_back(open.empty() ? random.pick(STATEMENTS) : random.pick(ELEMENTS));
+                startTag(unit, open.back(), options, random);
+                ++element;
+                if (random.below(2) == 0)
+                    unit += random.pick(WORDS);
+            } else {
+                unit += random.pick(WORDS);
+                unit += "</";
+                unit += open.back();
+                unit += '>';
+                open.pop_back();
+                unit += ' ';
+            }
+        }
+        while (!open.empty()) {
+            unit += random.pick(WORDS);
+            unit += "</";
+            unit += open.back();
+            unit += '>';
+            open.pop_back();
+        }
+        unit += ";\n";
+    }
+
+    /*
+        Append a line of text words
+
+        @param[in, out] unit Text of the unit
+        @param[in, out] random Generator of pseudorandom numbers
+    */
+    void textLine(std::string& unit, Random& random) {
+
+        const int words = 4 + random.below(8);
+        for (int word = 0; word < words; ++word) {
+            unit += ' ';
+            unit += random.pick(WORDS);
+        }
+    }
+}
+
+/*
+    Parse a generator option of the form --name=value
+
+    @param[in] option Command-line option
+    @param[in, out] options Options, with the value of the option
+    @return If the option is a generator option
+*/
+bool parseCorpusOption(const std::string& option, CorpusOptions& options) {
+
+    const std::size_t equalPosition = option.find('=');
+    if (option.compare(0, 2, "--") != 0 || equalPosition == option.npos)
+        return false;
+    const std::string name = option.substr(2, equalPosition - 2);
+    const std::string value = option.substr(equalPosition + 1);
+    if (name == "size") {
+        // size with an optional K, M, or G suffix
+        char* suffix = nullptr;
+        options.size = std::strtoull(value.c_str(), &suffix, 10);
+        if (*suffix == 'K' || *suffix == 'k')
+            options.size *= 1024;
+        else if (*suffix == 'M' || *suffix == 'm')
+            options.size *= 1024 * 1024;
+        else if (*suffix == 'G' || *suffix == 'g')
+            options.size *= 1024 * 1024 * 1024;
+    } else if (name == "tags") {
+        options.tags = std::max(std::atoi(value.c_str()), 1);
+    } else if (name == "depth") {
+        options.depth = std::max(std::atoi(value.c_str()), 1);
+    } else if (name == "attributes") {
+        options.attributes = std::max(std::atoi(value.c_str()), 0);
+    } else if (name == "comments") {
+        options.comments = std::clamp(std::atoi(value.c_str()), 0, 100);
+    } else if (name == "cdata") {
+        options.cdata = std::clamp(std::atoi(value.c_str()), 0, 100);
+    } else if (name == "unit-size") {
+        options.unitSize = std::max(std::atoi(value.c_str()), 1);
+    } else if (name == "seed") {
+        options.seed = std::strtoull(value.c_str(), nullptr, 10);
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/*
+    Name of a corpus with its options, for the name of its file
+
+    @param[in] options Options of the corpus
+    @return Name, e.g., "t8-d4-a0-c10-x0-s32M"
+*/
+std::string corpusName(const CorpusOptions& options) {
+
+    std::string name = "t" + std::to_string(options.tags) + "-d" + std::to_string(options.depth) +
+                       "-a" + std::to_string(options.attributes) + "-c" + std::to_string(options.comments) +
+                       "-x" + std::to_string(options.cdata) + "-s";
+    if (options.size % (1024 * 1024) == 0)
+        name += std::to_string(options.size / (1024 * 1024)) + "M";
+    else
+        name += std::to_string(options.size);
+    if (options.unitSize != CorpusOptions().unitSize)
+        name += "-u" + std::to_string(options.unitSize);
+    if (options.seed != CorpusOptions().seed)
+        name += "-r" + std::to_string(options.seed);
+
+    return name;
+}
+
+/*
+    Generate the corpus
+
+    @param[in] options Options of the corpus
+    @param[out] output Stream of the srcML
+    @return Number of lines of the srcML
+*/
+std::uint64_t generateCorpus(const CorpusOptions& options, std::ostream& output) {
+
+    Random random(options.seed);
+    std::uint64_t size = 0;
+    std::uint64_t loc = 0;
+    std::string unit;
+    const std::string_view header = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<unit xmlns=\"http://www.srcML.org/srcML/src\" xmlns:cpp=\"http://www.srcML.org/srcML/cpp\" "
+        "xmlns:pos=\"http://www.srcML.org/srcML/position\" revision=\"1.0.0\">\n\n"sv;
+    output << header;
+    size += header.size();
+    for (int file = 0; size < options.size; ++file) {
+        unit.clear();
+        unit += "<unit revision=\"1.0.0\" language=\"C++\" filename=\"src/file" + std::to_string(file) + ".cpp\" hash=\"";
+        const char hex[] = "0123456789abcdef";
+        for (std::uint64_t hash = random.next(), digit = 0; digit < 16; ++digit, hash >>= 4)
+            unit += hex[hash & 0xF];
+        unit += "\"><function><type><name>int</name></type> <name>f" + std::to_string(file) +
+                "</name><parameter_list>()</parameter_list> <block>{<block_content>\n";
+        while (static_cast<int>(unit.size()) < options.unitSize) {
+            const int line = random.below(100);
+            if (line < options.comments) {
+                unit += "    <comment type=\"line\">//";
+                textLine(unit, random);
+                unit += "</comment>\n";
+            } else if (line < options.comments + options.cdata) {
+                unit += "    <![CDATA[";
+                textLine(unit, random);
+                unit += " ]]>\n";
+            } else {
+                codeLine(unit, options, random);
+            }
+        }
+        unit += "</block_content>}</block></function>\n</unit>\n\n";
+        loc += static_cast<std::uint64_t>(std::count(unit.begin(), unit.end(), '\n'));
+        size += unit.size();
+        output << unit;
+    }
+    output << "</unit>\n";
+
+    // lines of the XML declaration, root start tag, and root end tag
+    return loc + 4;
+}
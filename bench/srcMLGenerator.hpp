@@ -0,0 +1,65 @@
+/*
+    srcMLGenerator.hpp
+
+    Deterministic generator of a synthetic srcML archive for benchmarks.
+    The same options always generate the same bytes, on any platform, so
+    a corpus can be regenerated instead of downloaded.
+
+    Each unit of the archive is a function with lines of code. A line is an
+    expression statement with nested srcML elements and character entity
+    references, a line comment, or a CDATA section.
+*/
+
+#ifndef INCLUDED_SRCMLGENERATOR_HPP
+#define INCLUDED_SRCMLGENERATOR_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// shape of the generated srcML
+struct CorpusOptions {
+    // approximate size in bytes, rounded up to whole units
+    std::uint64_t size = 32 * 1024 * 1024;
+    // elements in a line of code
+    int tags = 8;
+    // maximum depth of the elements in a line of code
+    int depth = 4;
+    // attributes of each element in a line of code
+    int attributes = 0;
+    // percent of lines that are comments
+    int comments = 10;
+    // percent of lines that are CDATA sections
+    int cdata = 0;
+    // approximate size of a unit in bytes
+    int unitSize = 16 * 1024;
+    std::uint64_t seed = 1;
+};
+
+/*
+    Parse a generator option of the form --name=value
+
+    @param[in] option Command-line option
+    @param[in, out] options Options, with the value of the option
+    @return If the option is a generator option
+*/
+bool parseCorpusOption(const std::string& option, CorpusOptions& options);
+
+/*
+    Name of a corpus with its options, for the name of its file
+
+    @param[in] options Options of the corpus
+    @return Name, e.g., "t8-d4-a0-c10-x0-s32M"
+*/
+std::string corpusName(const CorpusOptions& options);
+
+/*
+    Generate the corpus
+
+    @param[in] options Options of the corpus
+    @param[out] output Stream of the srcML
+    @return Number of lines of the srcML
+*/
+std::uint64_t generateCorpus(const CorpusOptions& options, std::ostream& output);
+
+#endif
@@ -0,0 +1,110 @@
+/*
+    countedElements.hpp
+
+    Elements counted by srcFacts. A perfect hash from the local name of
+    an element to its counter is generated at compile time, so a start tag
+    costs one hash and at most one name comparison, regardless of how many
+    elements are counted. To count another element, add it to
+    CountedElement and its name to COUNTED_ELEMENT_NAMES, and FactCounters
+    grows by whole cache lines. Only the elements in the report are counted.
+*/
+
+#ifndef INCLUDED_COUNTEDELEMENTS_HPP
+#define INCLUDED_COUNTEDELEMENTS_HPP
+
+#include <string_view>
+#include <array>
+#include <cstdint>
+
+// counted elements, as indexes of their counters
+enum CountedElement { EXPR, DECL, COMMENT, FUNCTION, UNIT, CLASS, COUNTED_ELEMENTS };
+
+// local names of the counted elements, in the order of CountedElement
+constexpr std::array<std::string_view, COUNTED_ELEMENTS> COUNTED_ELEMENT_NAMES = {
+    "expr", "decl", "comment", "function", "unit", "class",
+};
+
+// bits of the hash, for a table with at most one quarter of the slots used
+constexpr int elementHashBits() {
+
+    int bits = 1;
+    while ((1 << bits) < 4 * COUNTED_ELEMENTS)
+        ++bits;
+
+    return bits;
+}
+
+constexpr int ELEMENT_HASH_BITS = elementHashBits();
+
+// key of a name from its length, and first, second, and last characters
+constexpr std::uint32_t elementKey(std::string_view name) {
+
+    return static_cast<std::uint32_t>(static_cast<unsigned char>(name[0]))
+         | static_cast<std::uint32_t>(name.size() > 1 ? static_cast<unsigned char>(name[1]) : 0) << 8
+         | static_cast<std::uint32_t>(static_cast<unsigned char>(name.back())) << 16
+         | static_cast<std::uint32_t>(name.size() & 0xFF) << 24;
+}
+
+// multiplicative hash of a key
+constexpr unsigned elementHash(std::uint32_t key, std::uint32_t seed) {
+
+    return static_cast<std::uint32_t>(key * seed) >> (32 - ELEMENT_HASH_BITS);
+}
+
+// first odd seed where the counted element names do not collide
+constexpr std::uint32_t findElementSeed() {
+
+    for (std::uint32_t seed = 0x9E3779B1; seed != 0x9E3779B1 + 2 * 100000; seed += 2) {
+        bool used[1 << ELEMENT_HASH_BITS] = {};
+        bool collision = false;
+        for (const auto name : COUNTED_ELEMENT_NAMES) {
+            const unsigned hash = elementHash(elementKey(name), seed);
+            collision = collision || used[hash];
+            used[hash] = true;
+        }
+        if (!collision)
+            return seed;
+    }
+
+    return 0;
+}
+
+constexpr std::uint32_t ELEMENT_SEED = findElementSeed();
+static_assert(ELEMENT_SEED != 0, "No perfect hash seed for the counted element names");
+
+// counted element of each hash, -1 for none
+constexpr std::array<signed char, 1 << ELEMENT_HASH_BITS> makeElementTable() {
+
+    std::array<signed char, 1 << ELEMENT_HASH_BITS> table{};
+    for (auto& element : table)
+        element = -1;
+    for (int element = 0; element < COUNTED_ELEMENTS; ++element)
+        table[elementHash(elementKey(COUNTED_ELEMENT_NAMES[element]), ELEMENT_SEED)] = static_cast<signed char>(element);
+
+    return table;
+}
+
+inline constexpr std::array<signed char, 1 << ELEMENT_HASH_BITS> ELEMENT_TABLE = makeElementTable();
+
+/*
+    Counted element of a local name.
+
+    @param[in] localName Local name of the element
+    @return CountedElement of the element
+    @retval -1 Element is not counted
+*/
+constexpr int countedElement(std::string_view localName) {
+
+    if (localName.empty())
+        return -1;
+
+    const int element = ELEMENT_TABLE[elementHash(elementKey(localName), ELEMENT_SEED)];
+    if (element == -1 || COUNTED_ELEMENT_NAMES[element] != localName)
+        return -1;
+
+    return element;
+}
+
+static_assert(countedElement("expr") == EXPR && countedElement("class") == CLASS && countedElement("name") == -1);
+
+#endif
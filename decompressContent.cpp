@@ -0,0 +1,619 @@
+/*
+    decompressContent.cpp
+
+    Implementation of the decompression of compressed srcML input.
+
+    Each format is decompressed from a source of compressed bytes to a
+    sink of content, so the same decompressors stream from a file
+    descriptor into a pipe on a thread, and decompress a mapped file into
+    a buffer.
+*/
+
+#include "decompressContent.hpp"
+#include "refillContent.hpp"
+
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <errno.h>
+
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace {
+
+    // read up to a number of bytes of compressed input, returning the bytes read, 0 at EOF, -1 on error
+    using ReadInput = std::function<long(char* data, std::size_t size)>;
+
+    // write the content, returning false on error
+    using WriteContent = std::function<bool(const char* data, std::size_t size)>;
+
+    // size of the chunks of compressed input and of content
+    const std::size_t CHUNK_SIZE = BUFFER_SIZE;
+
+    // zero bytes after the decompressed content of a buffer
+    const std::size_t GUARD_SIZE = BLOCK_SIZE;
+
+    // status of the streaming decompression, set by its thread
+    std::atomic<int> streamStatus{ 0 };
+
+    /*
+        Read exactly a number of bytes of input.
+
+        @param[in] read Source of the input
+        @param[out] data Bytes read
+        @param[in] size Number of bytes
+        @return If all bytes were read
+    */
+    bool readExactly(const ReadInput& read, char* data, std::size_t size) {
+
+        while (size > 0) {
+            const long bytesRead = read(data, size);
+            if (bytesRead <= 0)
+                return false;
+            data += bytesRead;
+            size -= bytesRead;
+        }
+
+        return true;
+    }
+
+    /*
+        Name of a compression format for messages.
+
+        @param[in] compression Compression format
+        @return Name of the format
+    */
+    const char* compressionName(Compression compression) {
+
+        switch (compression) {
+        case Compression::GZIP: return "gzip";
+        case Compression::ZIP:  return "zip";
+        case Compression::ZSTD: return "zstd";
+        default:                return "uncompressed";
+        }
+    }
+
+#if defined(HAVE_ZLIB)
+    /*
+        Inflate deflate streams, either gzip members or a raw deflate stream.
+
+        @param[in] read Source of the compressed input
+        @param[in] write Sink of the content
+        @param[in] windowBits 15 + 16 for gzip, -15 for raw deflate
+        @return Status
+        @retval 0 Success
+        @retval -1 Error
+    */
+    int inflateInput(const ReadInput& read, const WriteContent& write, int windowBits) {
+
+        std::vector<char> input(CHUNK_SIZE);
+        std::vector<char> output(CHUNK_SIZE);
+        z_stream stream{};
+        if (inflateInit2(&stream, windowBits) != Z_OK)
+            return -1;
+        int status = Z_OK;
+        bool done = false;
+        while (true) {
+            if (stream.avail_in == 0) {
+                const long bytesRead = read(input.data(), input.size());
+                if (bytesRead < 0)
+                    break;
+                // EOF is only valid at the end of a stream
+                if (bytesRead == 0) {
+                    done = status == Z_STREAM_END;
+                    break;
+                }
+                stream.next_in = reinterpret_cast<Bytef*>(input.data());
+                stream.avail_in = static_cast<uInt>(bytesRead);
+            }
+            // another gzip member follows the end of a stream
+            if (status == Z_STREAM_END)
+                inflateReset(&stream);
+            stream.next_out = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            status = inflate(&stream, Z_NO_FLUSH);
+            if (status != Z_OK && status != Z_STREAM_END)
+                break;
+            if (!write(output.data(), output.size() - stream.avail_out))
+                break;
+            // the raw deflate of a zip entry ends at its stream
+            if (status == Z_STREAM_END && windowBits < 0) {
+                done = true;
+                break;
+            }
+        }
+        inflateEnd(&stream);
+
+        return done ? 0 : -1;
+    }
+#endif
+
+    /*
+        Decompress the first entry of a zip archive from its local file header.
+
+        @param[in] read Source of the compressed input
+        @param[in] write Sink of the content
+        @return Status
+        @retval 0 Success
+        @retval -1 Error, or an unsupported compression method
+    */
+    int unzipInput(const ReadInput& read, const WriteContent& write) {
+
+        // local file header, with the little-endian fields at fixed offsets
+        unsigned char header[30];
+        if (!readExactly(read, reinterpret_cast<char*>(header), sizeof(header)))
+            return -1;
+        const auto field16 = [](const unsigned char* data) -> std::uint64_t {
+            return data[0] | data[1] << 8;
+        };
+        const auto field32 = [&field16](const unsigned char* data) -> std::uint64_t {
+            return field16(data) | field16(data + 2) << 16;
+        };
+        const auto flags = field16(header + 6);
+        const auto method = field16(header + 8);
+        std::uint64_t compressedSize = field32(header + 18);
+        std::vector<char> nameExtra(field16(header + 26) + field16(header + 28));
+        if (!readExactly(read, nameExtra.data(), nameExtra.size()))
+            return -1;
+
+        // zip64 extended information extra field has the 64-bit sizes
+        if (compressedSize == 0xFFFFFFFF) {
+            const auto* extra = reinterpret_cast<const unsigned char*>(nameExtra.data()) + field16(header + 26);
+            const auto* extraEnd = reinterpret_cast<const unsigned char*>(nameExtra.data()) + nameExtra.size();
+            while (extra + 4 <= extraEnd) {
+                const auto size = field16(extra + 2);
+                if (field16(extra) == 0x0001 && size >= 16) {
+                    compressedSize = field32(extra + 12) | field32(extra + 16) << 32;
+                    break;
+                }
+                extra += 4 + size;
+            }
+        }
+
+        if (method == 8) {
+#if defined(HAVE_ZLIB)
+            return inflateInput(read, write, -MAX_WBITS);
+#else
+            std::cerr << "srcfacts : zip input requires zlib, which is not in this build\n";
+            return -1;
+#endif
+        }
+        // stored entries have their size in the header, unless it follows the data
+        if (method == 0 && !(flags & 0x08)) {
+            std::vector<char> data(CHUNK_SIZE);
+            while (compressedSize > 0) {
+                const long bytesRead = read(data.data(), std::min<std::uint64_t>(data.size(), compressedSize));
+                if (bytesRead <= 0 || !write(data.data(), bytesRead))
+                    return -1;
+                compressedSize -= bytesRead;
+            }
+            return 0;
+        }
+
+        std::cerr << "srcfacts : Unsupported zip compression method " << method << '\n';
+        return -1;
+    }
+
+#if defined(HAVE_ZSTD)
+    /*
+        Decompress zstd frames.
+
+        @param[in] read Source of the compressed input
+        @param[in] write Sink of the content
+        @return Status
+        @retval 0 Success
+        @retval -1 Error
+    */
+    int unzstdInput(const ReadInput& read, const WriteContent& write) {
+
+        std::vector<char> input(ZSTD_DStreamInSize());
+        std::vector<char> output(ZSTD_DStreamOutSize());
+        ZSTD_DStream* stream = ZSTD_createDStream();
+        if (!stream)
+            return -1;
+        ZSTD_initDStream(stream);
+        std::size_t remaining = 0;
+        bool error = false;
+        while (!error) {
+            const long bytesRead = read(input.data(), input.size());
+            if (bytesRead <= 0) {
+                // EOF is only valid at the end of a frame
+                error = bytesRead < 0 || remaining != 0;
+                break;
+            }
+            ZSTD_inBuffer in{ input.data(), static_cast<std::size_t>(bytesRead), 0 };
+            while (in.pos < in.size) {
+                ZSTD_outBuffer out{ output.data(), output.size(), 0 };
+                remaining = ZSTD_decompressStream(stream, &out, &in);
+                if (ZSTD_isError(remaining) || !write(output.data(), out.pos)) {
+                    error = true;
+                    break;
+                }
+            }
+        }
+        ZSTD_freeDStream(stream);
+
+        return error ? -1 : 0;
+    }
+#endif
+
+    /*
+        Decompress the input in a compression format.
+
+        @param[in] compression Compression format of the input
+        @param[in] read Source of the compressed input
+        @param[in] write Sink of the content
+        @return Status
+        @retval 0 Success
+        @retval -1 Error, with the message on standard error
+    */
+    int decompressInput(Compression compression, const ReadInput& read, const WriteContent& write) {
+
+        int status = -1;
+        switch (compression) {
+        case Compression::ZIP:
+            status = unzipInput(read, write);
+            break;
+#if defined(HAVE_ZLIB)
+        case Compression::GZIP:
+            status = inflateInput(read, write, MAX_WBITS + 16);
+            break;
+#endif
+#if defined(HAVE_ZSTD)
+        case Compression::ZSTD:
+            status = unzstdInput(read, write);
+            break;
+#endif
+        default:
+            return -1;
+        }
+        if (status != 0)
+            std::cerr << "srcfacts : Error decompressing " << compressionName(compression) << " input\n";
+
+        return status;
+    }
+
+    /*
+        Check that this build has the library of a compression format.
+
+        @param[in] compression Compression format
+        @return If the format can be decompressed, otherwise with the
+            message on standard error
+    */
+    bool compressionSupported(Compression compression) {
+
+        switch (compression) {
+#if defined(HAVE_ZLIB)
+        case Compression::GZIP:
+#endif
+#if defined(HAVE_ZSTD)
+        case Compression::ZSTD:
+#endif
+        case Compression::ZIP:
+        case Compression::NONE:
+            return true;
+        default:
+            std::cerr << "srcfacts : " << compressionName(compression) << " input is not supported by this build\n";
+            return false;
+        }
+    }
+
+#if !defined(_MSC_VER)
+    /*
+        Write all of the data to a file descriptor.
+
+        @param[in] fd File descriptor
+        @param[in] data Data to write
+        @param[in] size Number of bytes
+        @return If all of the data was written
+    */
+    bool writeAll(int fd, const char* data, std::size_t size) {
+
+        while (size > 0) {
+            const ssize_t bytesWritten = write(fd, data, size);
+            if (bytesWritten == -1 && errno == EINTR)
+                continue;
+            if (bytesWritten <= 0)
+                return false;
+            data += bytesWritten;
+            size -= bytesWritten;
+        }
+
+        return true;
+    }
+
+#if defined(__linux__)
+    /*
+        Copy the start of the input of a pipe without consuming it. The
+        bytes are duplicated into a second pipe, and read from there.
+
+        @param[in] fd File descriptor of the input pipe
+        @param[out] start Start of the input, empty at EOF
+        @param[in] size Number of bytes of the start
+        @return If the start was copied, otherwise the input is unchanged,
+            e.g., it is not a pipe or has fewer bytes available
+    */
+    bool peekPipe(int fd, std::string& start, std::size_t size) {
+
+        int peekFds[2];
+        if (pipe(peekFds) == -1)
+            return false;
+        ssize_t bytesCopied = 0;
+        while ((bytesCopied = tee(fd, peekFds[1], size, 0)) == -1 && errno == EINTR) {
+        }
+        bool peeked = bytesCopied == 0;
+        if (bytesCopied == static_cast<ssize_t>(size)) {
+            start.resize(size);
+            peeked = read(peekFds[0], start.data(), size) == bytesCopied;
+        }
+        close(peekFds[0]);
+        close(peekFds[1]);
+        if (!peeked)
+            start.clear();
+
+        return peeked;
+    }
+#endif
+
+    /*
+        Decompress, or pass through, the input into the pipe, then close
+        the pipe so that the parser sees EOF.
+
+        @param[in] compression Compression format of the input
+        @param[in] inputFd File descriptor of the input
+        @param[in] pipeFd File descriptor of the write end of the pipe
+        @param[in] start Bytes already read from the start of the input
+        @param[out] status Status of the decompression, set before the pipe is closed
+    */
+    void decompressToPipe(Compression compression, int inputFd, int pipeFd, std::string start, std::atomic<int>& status) {
+
+        std::size_t startUsed = 0;
+        const ReadInput read = [&](char* data, std::size_t size) -> long {
+            if (startUsed < start.size()) {
+                const std::size_t bytes = std::min(size, start.size() - startUsed);
+                std::memcpy(data, start.data() + startUsed, bytes);
+                startUsed += bytes;
+                return static_cast<long>(bytes);
+            }
+            while (true) {
+                const ssize_t bytesRead = ::read(inputFd, data, size);
+                if (bytesRead == -1 && errno == EINTR)
+                    continue;
+                return static_cast<long>(bytesRead);
+            }
+        };
+        const WriteContent writePipe = [pipeFd](const char* data, std::size_t size) {
+            return writeAll(pipeFd, data, size);
+        };
+        if (compression == Compression::NONE) {
+            bool passing = writePipe(start.data(), start.size());
+            startUsed = start.size();
+#if defined(__linux__)
+            // pages move from the input into the pipe without a copy, when the input supports it
+            ssize_t bytesSpliced = 0;
+            while (passing && ((bytesSpliced = splice(inputFd, nullptr, pipeFd, nullptr, CHUNK_SIZE, SPLICE_F_MOVE)) > 0
+                               || (bytesSpliced == -1 && errno == EINTR)))
+                ;
+            passing = passing && bytesSpliced == -1 && errno == EINVAL;
+#endif
+            std::vector<char> data(CHUNK_SIZE);
+            long bytesRead = 0;
+            while (passing && (bytesRead = read(data.data(), data.size())) > 0 && writePipe(data.data(), bytesRead))
+                ;
+        } else {
+            status = decompressInput(compression, read, writePipe);
+        }
+        close(pipeFd);
+        close(inputFd);
+    }
+#endif
+}
+
+/*
+    Detect the compression format from the magic bytes.
+
+    @param[in] start View of the start of the input, at least 4 bytes
+        for detection
+    @return Compression format
+    @retval Compression::NONE Not a compressed format
+*/
+Compression detectCompression(std::string_view start) {
+
+    using namespace std::literals::string_view_literals;
+    if (start.compare(0, 2, "\x1F\x8B"sv) == 0)
+        return Compression::GZIP;
+    if (start.compare(0, 4, "PK\x03\x04"sv) == 0)
+        return Compression::ZIP;
+    if (start.compare(0, 4, "\x28\xB5\x2F\xFD"sv) == 0)
+        return Compression::ZSTD;
+
+    return Compression::NONE;
+}
+
+/*
+    Start streaming decompression of the input on its own thread. A
+    compressed input is replaced by a pipe of the decompressed content,
+    so refillContent() reads decompressed content with any input engine.
+    Input that is not compressed is left as is when its start can be
+    read without consuming it, i.e., a regular file, or a pipe on Linux.
+    Other input that is not compressed is passed through.
+
+    @param[in] fd File descriptor of the input, replaced when compressed
+    @return Status
+    @retval 0 Success
+    @retval -1 Compression format not supported by this build, or an
+        error, with the message on standard error
+*/
+[[nodiscard]] int startDecompression(int fd) {
+
+#if !defined(_MSC_VER)
+    // the start of a regular file is read in place, and the start of a
+    // pipe is peeked, otherwise it is consumed, and then passed on by the thread
+    char magic[4] = {};
+    std::string start;
+    struct stat status;
+    const bool regular = fstat(fd, &status) == 0 && S_ISREG(status.st_mode);
+    bool inPlace = regular;
+    if (regular) {
+        const ssize_t bytesRead = pread(fd, magic, sizeof(magic), 0);
+        if (bytesRead > 0)
+            start.assign(magic, bytesRead);
+#if defined(__linux__)
+    } else if (S_ISFIFO(status.st_mode) && peekPipe(fd, start, sizeof(magic))) {
+        inPlace = true;
+#endif
+    } else {
+        start.resize(sizeof(magic));
+        std::size_t size = 0;
+        while (size < start.size()) {
+            const ssize_t bytesRead = read(fd, start.data() + size, start.size() - size);
+            if (bytesRead == -1 && errno == EINTR)
+                continue;
+            if (bytesRead <= 0)
+                break;
+            size += bytesRead;
+        }
+        start.resize(size);
+    }
+    const Compression compression = detectCompression(start);
+    if (!compressionSupported(compression))
+        return -1;
+    // input that is not compressed is read directly, without the thread
+    if (inPlace && compression == Compression::NONE)
+        return 0;
+    if (inPlace)
+        start.clear();
+
+    // the thread reads from a duplicate of the input, and the pipe replaces the input
+    int pipeFds[2];
+    if (pipe(pipeFds) == -1)
+        return -1;
+#if defined(F_SETPIPE_SZ)
+    fcntl(pipeFds[1], F_SETPIPE_SZ, static_cast<int>(CHUNK_SIZE));
+#endif
+    const int inputFd = dup(fd);
+    if (inputFd == -1 || dup2(pipeFds[0], fd) == -1) {
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        return -1;
+    }
+    close(pipeFds[0]);
+
+    // detached, since it may still be blocked on the pipe when the parser finishes
+    std::thread(decompressToPipe, compression, inputFd, pipeFds[1], std::move(start), std::ref(streamStatus)).detach();
+
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+/*
+    Start streaming decompression of a compressed file on its own thread,
+    e.g., for one file of a multiple-file run, into a pipe of the
+    decompressed content.
+
+    @param[in] fd File descriptor of the compressed file, closed by the thread
+    @param[out] status Status of the decompression, set by the thread
+        before the end of the content of the pipe
+    @return File descriptor of the read end of the pipe
+    @retval -1 Compression format not supported by this build, or an
+        error, with the message on standard error
+*/
+[[nodiscard]] int startFileDecompression(int fd, std::atomic<int>& status) {
+
+#if !defined(_MSC_VER)
+    char magic[4] = {};
+    const ssize_t bytesRead = pread(fd, magic, sizeof(magic), 0);
+    const Compression compression = detectCompression(std::string_view(magic, std::max<ssize_t>(bytesRead, 0)));
+    if (!compressionSupported(compression)) {
+        close(fd);
+        return -1;
+    }
+    int pipeFds[2];
+    if (pipe(pipeFds) == -1) {
+        close(fd);
+        return -1;
+    }
+#if defined(F_SETPIPE_SZ)
+    fcntl(pipeFds[1], F_SETPIPE_SZ, static_cast<int>(CHUNK_SIZE));
+#endif
+    status = 0;
+    // the reader of the pipe reads it to the end, so the thread is never blocked on it
+    std::thread(decompressToPipe, compression, fd, pipeFds[1], std::string(), std::ref(status)).detach();
+
+    return pipeFds[0];
+#else
+    close(fd);
+    return -1;
+#endif
+}
+
+/*
+    Status of the streaming decompression. An error ends the content
+    early, so the status is set before the parser sees the end.
+
+    @return Status
+    @retval 0 No error
+    @retval -1 Decompression error, with the message on standard error
+*/
+int decompressionStatus() {
+
+    return streamStatus;
+}
+
+/*
+    Decompress an entire compressed input, e.g., mapped from a file.
+    Zero bytes follow the content in the buffer, so that lookahead past
+    the end of the content stays inside the buffer.
+
+    @param[in] compressed View of the entire compressed input
+    @param[out] buffer Decompressed content, followed by zero bytes
+    @return Number of bytes of content at the start of the buffer
+    @retval -1 Compression format not supported by this build, or an
+        error, with the message on standard error
+*/
+[[nodiscard]] long decompressContent(std::string_view compressed, std::string& buffer) {
+
+    const Compression compression = detectCompression(compressed);
+    if (!compressionSupported(compression))
+        return -1;
+    buffer.clear();
+    if (compression == Compression::NONE) {
+        buffer.assign(compressed);
+    } else {
+        const ReadInput read = [&compressed](char* data, std::size_t size) -> long {
+            const std::size_t bytes = std::min(size, compressed.size());
+            std::memcpy(data, compressed.data(), bytes);
+            compressed.remove_prefix(bytes);
+            return static_cast<long>(bytes);
+        };
+        const WriteContent append = [&buffer](const char* data, std::size_t size) {
+            buffer.append(data, size);
+            return true;
+        };
+        if (decompressInput(compression, read, append) != 0)
+            return -1;
+    }
+    const long size = static_cast<long>(buffer.size());
+    buffer.append(GUARD_SIZE, '\0');
+
+    return size;
+}
@@ -0,0 +1,83 @@
+/*
+    decompressContent.hpp
+
+    Decompression of compressed srcML input for srcFacts. The format is
+    detected from the magic bytes at the start of the input: gzip, the
+    first entry of a zip archive, or zstd. Each format is available when
+    its library, zlib or zstd, is found at build time.
+*/
+
+#ifndef INCLUDED_DECOMPRESSCONTENT_HPP
+#define INCLUDED_DECOMPRESSCONTENT_HPP
+
+#include <string>
+#include <string_view>
+#include <atomic>
+
+// compression formats of the input
+enum class Compression { NONE, GZIP, ZIP, ZSTD };
+
+/*
+    Detect the compression format from the magic bytes.
+
+    @param[in] start View of the start of the input, at least 4 bytes
+        for detection
+    @return Compression format
+    @retval Compression::NONE Not a compressed format
+*/
+Compression detectCompression(std::string_view start);
+
+/*
+    Start streaming decompression of the input on its own thread. A
+    compressed input is replaced by a pipe of the decompressed content,
+    so refillContent() reads decompressed content with any input engine.
+    Input that is not compressed is left as is when its start can be
+    read without consuming it, i.e., a regular file, or a pipe on Linux.
+    Other input that is not compressed is passed through.
+
+    @param[in] fd File descriptor of the input, replaced when compressed
+    @return Status
+    @retval 0 Success
+    @retval -1 Compression format not supported by this build, or an
+        error, with the message on standard error
+*/
+[[nodiscard]] int startDecompression(int fd);
+
+/*
+    Start streaming decompression of a compressed file on its own thread,
+    e.g., for one file of a multiple-file run, into a pipe of the
+    decompressed content.
+
+    @param[in] fd File descriptor of the compressed file, closed by the thread
+    @param[out] status Status of the decompression, set by the thread
+        before the end of the content of the pipe
+    @return File descriptor of the read end of the pipe
+    @retval -1 Compression format not supported by this build, or an
+        error, with the message on standard error
+*/
+[[nodiscard]] int startFileDecompression(int fd, std::atomic<int>& status);
+
+/*
+    Status of the streaming decompression. An error ends the content
+    early, so the status is set before the parser sees the end.
+
+    @return Status
+    @retval 0 No error
+    @retval -1 Decompression error, with the message on standard error
+*/
+int decompressionStatus();
+
+/*
+    Decompress an entire compressed input, e.g., mapped from a file.
+    Zero bytes follow the content in the buffer, so that lookahead past
+    the end of the content stays inside the buffer.
+
+    @param[in] compressed View of the entire compressed input
+    @param[out] buffer Decompressed content, followed by zero bytes
+    @return Number of bytes of content at the start of the buffer
+    @retval -1 Compression format not supported by this build, or an
+        error, with the message on standard error
+*/
+[[nodiscard]] long decompressContent(std::string_view compressed, std::string& buffer);
+
+#endif
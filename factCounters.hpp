@@ -0,0 +1,55 @@
+/*
+    factCounters.hpp
+
+    Counters of the srcFacts measures. Each counter is 64 bits, since the
+    text of an archive of many projects is well over 2^31 characters. The
+    counters are aligned to, and padded to a multiple of, a cache line, so
+    the counters of the handlers of a parallel parse, one for each thread,
+    never share a cache line.
+*/
+
+#ifndef INCLUDED_FACTCOUNTERS_HPP
+#define INCLUDED_FACTCOUNTERS_HPP
+
+#include <cstdint>
+#include "countedElements.hpp"
+
+struct alignas(64) FactCounters {
+    std::uint64_t characters = 0;
+    std::uint64_t loc = 0;
+    std::uint64_t elementCounts[COUNTED_ELEMENTS] = {};
+
+    /*
+        Merge the counters of another part of the input
+
+        @param[in] other Counters to add
+    */
+    void merge(const FactCounters& other) {
+
+        characters += other.characters;
+        loc += other.loc;
+        for (int element = 0; element < COUNTED_ELEMENTS; ++element)
+            elementCounts[element] += other.elementCounts[element];
+    }
+
+    /*
+        Counts since earlier counters
+
+        @param[in] start Earlier value of these counters
+        @return Counters of the difference
+    */
+    FactCounters since(const FactCounters& start) const {
+
+        FactCounters difference;
+        difference.characters = characters - start.characters;
+        difference.loc = loc - start.loc;
+        for (int element = 0; element < COUNTED_ELEMENTS; ++element)
+            difference.elementCounts[element] = elementCounts[element] - start.elementCounts[element];
+
+        return difference;
+    }
+};
+
+static_assert(sizeof(FactCounters) % 64 == 0, "FactCounters is whole cache lines");
+
+#endif
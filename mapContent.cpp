@@ -0,0 +1,70 @@
+/*
+    mapContent.cpp
+
+    Implementation of the memory-mapped input for srcFacts.
+*/
+
+#include "mapContent.hpp"
+
+#if !defined(_MSC_VER)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+    Map the entire input into memory.
+    A guard page of zeros follows the content so that lookahead
+    past the end of the content stays inside the mapping.
+
+    @param[in] fd File descriptor of the input
+    @param[out] content View of the entire content
+    @return Number of bytes mapped
+    @retval 0 Input cannot be mapped, e.g., a pipe
+    @retval -1 Map error
+*/
+[[nodiscard]] long mapContent(int fd, std::string_view& content) {
+
+#if !defined(_MSC_VER)
+    // only regular files can be mapped
+    struct stat status;
+    if (fstat(fd, &status) == -1 || !S_ISREG(status.st_mode) || status.st_size == 0)
+        return 0;
+    const std::size_t size = status.st_size;
+
+    // reserve the address range for the content and the guard page
+    const std::size_t pageSize = sysconf(_SC_PAGESIZE);
+    void* region = mmap(nullptr, size + pageSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+        return -1;
+
+    // map the file over the start of the reserved range
+    void* data = mmap(region, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (data == MAP_FAILED) {
+        munmap(region, size + pageSize);
+        return -1;
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    content = std::string_view(static_cast<const char*>(data), size);
+
+    return static_cast<long>(size);
+#else
+    return 0;
+#endif
+}
+
+/*
+    Unmap content mapped by mapContent(), including the guard page.
+
+    @param[in] content View of the entire content
+*/
+void unmapContent(std::string_view content) {
+
+#if !defined(_MSC_VER)
+    if (content.empty())
+        return;
+    const std::size_t pageSize = sysconf(_SC_PAGESIZE);
+    munmap(const_cast<char*>(content.data()), content.size() + pageSize);
+#endif
+}
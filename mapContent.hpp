@@ -0,0 +1,33 @@
+/*
+    mapContent.hpp
+
+    Memory-mapped input for srcFacts. A regular file is mapped whole, and
+    parsed in place without refills.
+*/
+
+#ifndef INCLUDED_MAPCONTENT_HPP
+#define INCLUDED_MAPCONTENT_HPP
+
+#include <string_view>
+
+/*
+    Map the entire input into memory.
+    A guard page of zeros follows the content so that lookahead
+    past the end of the content stays inside the mapping.
+
+    @param[in] fd File descriptor of the input
+    @param[out] content View of the entire content
+    @return Number of bytes mapped
+    @retval 0 Input cannot be mapped, e.g., a pipe
+    @retval -1 Map error
+*/
+[[nodiscard]] long mapContent(int fd, std::string_view& content);
+
+/*
+    Unmap content mapped by mapContent(), including the guard page.
+
+    @param[in] content View of the entire content
+*/
+void unmapContent(std::string_view content);
+
+#endif
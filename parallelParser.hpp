@@ -0,0 +1,237 @@
+/*
+    parallelParser.hpp
+
+    Parallel parsing of srcML archives. The content of an archive is
+    split into segments at the start tags of the units inside the root
+    unit. Each segment is parsed by its own XMLParser and Handler, and
+    the handlers are merged in document order.
+
+    Speculative parallel parsing splits any document, e.g., a single
+    huge unit, into equal chunks at the next tag after each cut. A tag
+    found this way may be inside of a comment or CDATA, so a merge phase
+    checks each chunk boundary and reparses across a bad one.
+*/
+
+#ifndef INCLUDED_PARALLELPARSER_HPP
+#define INCLUDED_PARALLELPARSER_HPP
+
+#include "xmlParser.hpp"
+#include "scanContent.hpp"
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+/*
+    Find the start tag of a unit at or after a position. Units inside
+    of the root unit of an archive start a line.
+
+    @param[in] content View of the content
+    @param[in] pos Position to start the search
+    @return Position of the '<' of the unit start tag
+    @retval content.npos No unit start tag after the position
+*/
+inline std::size_t findUnitStart(std::string_view content, std::size_t pos) {
+
+    using namespace std::literals::string_view_literals;
+    while (true) {
+        pos = content.find("\n<unit"sv, pos);
+        if (pos == content.npos || pos + "\n<unit"sv.size() >= content.size())
+            return content.npos;
+        const char next = content[pos + "\n<unit"sv.size()];
+        if (next == ' ' || next == '>')
+            return pos + 1;
+        ++pos;
+    }
+}
+
+/*
+    Find the start of a start or end tag at or after a position, i.e.,
+    a '<' followed by a name start character or '/'.
+
+    @param[in] content View of the content
+    @param[in] pos Position to start the search
+    @return Position of the '<' of the tag
+    @retval content.npos No tag after the position
+*/
+inline std::size_t findTagStart(std::string_view content, std::size_t pos) {
+
+    while (true) {
+        pos = content.find('<', pos);
+        if (pos == content.npos || pos + 1 >= content.size())
+            return content.npos;
+        if (content[pos + 1] == '/' || isCharacterClass(content[pos + 1], NAME_START_CHAR))
+            return pos;
+        ++pos;
+    }
+}
+
+/*
+    Parse the content of a document in parallel, split at the units of
+    a srcML archive. A document that is not an archive, or is too small
+    to split, is parsed by a single parser.
+
+    @param[in] content View of the entire document
+    @param[in] jobs Number of threads
+    @param[out] handler Handler with the merged results of all segments
+    @return Status of the parse
+    @retval 0 Success
+    @retval 1 Parser error, with the message on standard error
+*/
+template <class Handler>
+int parseParallel(std::string_view content, int jobs, Handler& handler) {
+
+    using namespace std::literals::string_view_literals;
+
+    // segment starts, with more segments than threads to balance the load
+    std::vector<std::size_t> starts{ 0 };
+    const std::size_t rootStart = content.find("<unit"sv);
+    if (jobs > 1 && rootStart != content.npos) {
+        const std::size_t segments = static_cast<std::size_t>(jobs) * 4;
+        for (std::size_t segment = 1; segment < segments; ++segment) {
+            const std::size_t target = std::max(content.size() / segments * segment, starts.back() + 1);
+            const std::size_t start = findUnitStart(content, std::max(target, rootStart + 1) - 1);
+            if (start == content.npos)
+                break;
+            starts.push_back(start);
+        }
+    }
+    if (starts.size() == 1) {
+        XMLParser<Handler> parser(handler, content);
+        return parser.parse();
+    }
+    starts.push_back(content.size());
+
+    // each thread parses the next unparsed segment
+    const std::size_t segments = starts.size() - 1;
+    std::vector<Handler> handlers(segments);
+    std::vector<int> status(segments, 0);
+    std::atomic<std::size_t> nextSegment{ 0 };
+    const auto parseSegments = [&]() {
+        for (std::size_t segment = nextSegment++; segment < segments; segment = nextSegment++) {
+            XMLParser<Handler> parser(handlers[segment], content.substr(starts[segment], starts[segment + 1] - starts[segment]), starts[segment]);
+            status[segment] = parser.parseSegment(segment == 0 ? 0 : 1);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int thread = 1; thread < jobs; ++thread)
+        threads.emplace_back(parseSegments);
+    parseSegments();
+    for (auto& thread : threads)
+        thread.join();
+
+    // merge in document order
+    for (std::size_t segment = 0; segment < segments; ++segment) {
+        if (status[segment] != 0)
+            return 1;
+        handler.merge(handlers[segment]);
+    }
+
+    return 0;
+}
+
+/*
+    Parse the content of a document in parallel, split into equal chunks
+    at the next start or end tag after each cut. The chunks are parsed
+    speculatively, without knowing if a chunk starts inside of a comment,
+    CDATA, or processing instruction. The start of the first chunk is
+    known, and a chunk that parses starts the next chunk at a known tag.
+    A chunk that fails ends inside of a comment, CDATA, or processing
+    instruction, so it is reparsed together with the next chunk. An error
+    in the document, and tags that do not balance, are reported by a
+    parse of the entire document with a single parser.
+
+    @param[in] content View of the entire document
+    @param[in] jobs Number of threads
+    @param[out] handler Handler with the merged results of all chunks
+    @return Status of the parse
+    @retval 0 Success
+    @retval 1 Parser error, with the message on standard error
+*/
+template <class Handler>
+int parseSpeculative(std::string_view content, int jobs, Handler& handler) {
+
+    // chunk starts, with the cuts after the start of the root element
+    std::vector<std::size_t> starts{ 0 };
+    const std::size_t rootStart = findTagStart(content, 0);
+    if (jobs > 1 && rootStart != content.npos) {
+        const std::size_t chunks = static_cast<std::size_t>(jobs) * 4;
+        for (std::size_t chunk = 1; chunk < chunks; ++chunk) {
+            const std::size_t target = std::max(content.size() / chunks * chunk, starts.back() + 1);
+            const std::size_t start = findTagStart(content, std::max(target, rootStart + 1));
+            if (start == content.npos)
+                break;
+            starts.push_back(start);
+        }
+    }
+    if (starts.size() == 1) {
+        XMLParser<Handler> parser(handler, content);
+        return parser.parse();
+    }
+    // the last chunk, with the end of the root element, is short
+    const std::size_t lastStart = findTagStart(content, std::max(content.size(), static_cast<std::size_t>(BLOCK_SIZE)) - BLOCK_SIZE);
+    if (lastStart != content.npos && lastStart > starts.back())
+        starts.push_back(lastStart);
+    starts.push_back(content.size());
+
+    /*
+        A chunk after the first starts at an unknown depth, so it is parsed
+        from a depth that cannot return to 0, and the change in depth is
+        kept. The last chunk ends the root element at depth 0, so it is
+        only parsed when its start depth is known.
+    */
+    constexpr int UNKNOWN_DEPTH = 1 << 30;
+    const std::size_t chunks = starts.size() - 1;
+    std::vector<Handler> handlers(chunks);
+    std::vector<int> status(chunks, 0);
+    std::vector<int> depthChange(chunks, 0);
+    const auto parseChunk = [&](std::size_t chunk, std::size_t end, int startDepth) {
+        handlers[chunk] = Handler();
+        XMLParser<Handler> parser(handlers[chunk], content.substr(starts[chunk], starts[end] - starts[chunk]), starts[chunk]);
+        status[chunk] = parser.parseSegment(startDepth, false);
+        depthChange[chunk] = parser.segmentDepth() - startDepth;
+    };
+    std::atomic<std::size_t> nextChunk{ 0 };
+    const auto parseChunks = [&]() {
+        for (std::size_t chunk = nextChunk++; chunk < chunks - 1; chunk = nextChunk++)
+            parseChunk(chunk, chunk + 1, chunk == 0 ? 0 : UNKNOWN_DEPTH);
+    };
+    std::vector<std::thread> threads;
+    for (int thread = 1; thread < jobs; ++thread)
+        threads.emplace_back(parseChunks);
+    parseChunks();
+    for (auto& thread : threads)
+        thread.join();
+
+    // check the chunks in document order, reparsing a failed chunk with
+    // the following chunks until it parses
+    std::vector<std::size_t> parsedChunks;
+    int depth = 0;
+    bool valid = true;
+    for (std::size_t chunk = 0; chunk < chunks && valid; ) {
+        std::size_t end = chunk + 1;
+        if (end == chunks)
+            parseChunk(chunk, end, depth);
+        while (status[chunk] != 0 && end < chunks) {
+            ++end;
+            parseChunk(chunk, end, end == chunks ? depth : (chunk == 0 ? 0 : UNKNOWN_DEPTH));
+        }
+        valid = status[chunk] == 0 && (chunk == 0 || depth > 0);
+        depth += depthChange[chunk];
+        parsedChunks.push_back(chunk);
+        chunk = end;
+    }
+    if (!valid || depth != 0) {
+        XMLParser<Handler> parser(handler, content);
+        return parser.parse();
+    }
+
+    // merge in document order
+    for (const auto chunk : parsedChunks)
+        handler.merge(handlers[chunk]);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,186 @@
+/*
+    perfCounters.cpp
+
+    Implementation of the hardware performance counters of a srcFacts run.
+
+    Each event is a separate counter, not a group, so that the kernel can
+    multiplex events that do not fit on the PMU together. The time enabled
+    and the time running of each counter scale its count.
+*/
+
+#include "perfCounters.hpp"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#endif
+
+namespace {
+
+    // file descriptors of the counters, -1 when unavailable
+    int counters[PERF_EVENTS] = { -1, -1, -1, -1, -1, -1 };
+
+    bool userOnly = false;
+
+    // at least one counter is available
+    bool counting = false;
+
+    // counts while waiting for input, and at the start of the current wait
+    PerfCounts waitCounts;
+    PerfCounts waitStart;
+
+    /*
+        Read a counter, scaled when multiplexed.
+
+        @param[in] fd File descriptor of the counter
+        @param[out] value Count
+        @return If the counter was read
+    */
+    bool readCounter(int fd, std::uint64_t& value) {
+
+#if defined(__linux__)
+        // value, time enabled, time running
+        std::uint64_t data[3] = {};
+        if (fd == -1 || read(fd, data, sizeof(data)) != sizeof(data))
+            return false;
+        value = data[0];
+        if (data[2] != 0 && data[2] < data[1])
+            value = static_cast<std::uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+
+        return true;
+#else
+        (void) fd;
+        (void) value;
+        return false;
+#endif
+    }
+
+    /*
+        Read all counters.
+
+        @param[out] counts Counts
+    */
+    void readCounters(PerfCounts& counts) {
+
+        for (int event = 0; event < PERF_EVENTS; ++event)
+            counts.available[event] = readCounter(counters[event], counts.values[event]);
+    }
+
+#if defined(__linux__)
+    /*
+        Open the counter of an event for the calling thread.
+
+        @param[in] type Type of the event
+        @param[in] config Event of the type
+        @param[in] excludeKernel If kernel events are excluded
+        @return File descriptor of the counter
+        @retval -1 Unavailable
+    */
+    int openCounter(std::uint32_t type, std::uint64_t config, bool excludeKernel) {
+
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = type;
+        attributes.config = config;
+        attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attributes.inherit = 1;
+        attributes.exclude_kernel = excludeKernel;
+        attributes.exclude_hv = 1;
+
+        return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    }
+#endif
+}
+
+/*
+    Open and start the counters for the calling thread, and the threads it
+    creates afterwards. Events are counted in user space and the kernel,
+    or only user space when the kernel is not permitted, e.g., by
+    perf_event_paranoid.
+
+    @return Number of available counters
+    @retval 0 No counters, e.g., perf_event_open is not permitted
+*/
+int startPerfCounters() {
+
+    int available = 0;
+#if defined(__linux__)
+    const struct {
+        std::uint32_t type;
+        std::uint64_t config;
+    } events[PERF_EVENTS] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    };
+
+    // the kernel may not be permitted, so user space only is tried when the first counter fails
+    for (int event = 0; event < PERF_EVENTS; ++event) {
+        counters[event] = openCounter(events[event].type, events[event].config, userOnly);
+        if (counters[event] == -1 && event == 0 && (errno == EACCES || errno == EPERM)) {
+            userOnly = true;
+            counters[event] = openCounter(events[event].type, events[event].config, userOnly);
+        }
+        if (counters[event] != -1)
+            ++available;
+    }
+    counting = available > 0;
+#endif
+
+    return available;
+}
+
+/*
+    Check if the counters only count user space.
+
+    @return If kernel events are excluded
+*/
+bool perfCountersUserOnly() {
+
+    return userOnly;
+}
+
+// start of a wait for input by the parser thread, when counting
+void beginPerfWait() {
+
+    if (!counting)
+        return;
+
+    readCounters(waitStart);
+}
+
+// end of a wait for input by the parser thread, when counting
+void endPerfWait() {
+
+    if (!counting)
+        return;
+
+    PerfCounts waitEnd;
+    readCounters(waitEnd);
+    for (int event = 0; event < PERF_EVENTS; ++event) {
+        if (waitEnd.available[event] && waitStart.available[event] && waitEnd.values[event] >= waitStart.values[event])
+            waitCounts.values[event] += waitEnd.values[event] - waitStart.values[event];
+    }
+}
+
+/*
+    Read the counters. Counts of a multiplexed counter are scaled to the
+    whole run. The run includes the threads that have already finished.
+
+    @param[out] run Counts of the run so far
+    @param[out] wait Counts of the parser thread while waiting for input
+*/
+void readPerfCounters(PerfCounts& run, PerfCounts& wait) {
+
+    readCounters(run);
+    wait = waitCounts;
+    for (int event = 0; event < PERF_EVENTS; ++event)
+        wait.available[event] = run.available[event];
+}
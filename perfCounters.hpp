@@ -0,0 +1,61 @@
+/*
+    perfCounters.hpp
+
+    Hardware performance counters of a srcFacts run, from perf_event_open
+    (Linux). The counters are opened by the parser thread, and inherited by
+    the threads it creates afterwards. The time the parser thread waits in
+    refillContent() for input is counted separately, so a run can be split
+    into waiting for input and parsing.
+*/
+
+#ifndef INCLUDED_PERFCOUNTERS_HPP
+#define INCLUDED_PERFCOUNTERS_HPP
+
+#include <cstdint>
+
+// counted events
+enum PerfEvent { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, PAGE_FAULTS, PERF_EVENTS };
+
+// names of the counted events, in the order of PerfEvent
+constexpr const char* PERF_EVENT_NAMES[] = { "cycles", "instructions", "branch misses", "L1D misses", "LLC misses", "page faults" };
+
+// counts of the events, where an unavailable event is not counted
+struct PerfCounts {
+    std::uint64_t values[PERF_EVENTS] = {};
+    bool available[PERF_EVENTS] = {};
+};
+
+/*
+    Open and start the counters for the calling thread, and the threads it
+    creates afterwards. Events are counted in user space and the kernel,
+    or only user space when the kernel is not permitted, e.g., by
+    perf_event_paranoid.
+
+    @return Number of available counters
+    @retval 0 No counters, e.g., perf_event_open is not permitted
+*/
+int startPerfCounters();
+
+/*
+    Check if the counters only count user space.
+
+    @return If kernel events are excluded
+*/
+bool perfCountersUserOnly();
+
+// start of a wait for input by the parser thread, when counting
+void beginPerfWait();
+
+// end of a wait for input by the parser thread, when counting
+void endPerfWait();
+
+/*
+    Read the counters. Counts of a multiplexed counter are scaled to the
+    whole run. The run includes the threads that have already finished.
+
+    @param[out] run Counts of the run so far
+    @param[out] wait Counts of the parser thread while waiting for input
+*/
+void readPerfCounters(PerfCounts& run, PerfCounts& wait);
+
+#endif
@@ -0,0 +1,310 @@
+/*
+    refillContent.cpp
+
+    Implementation of the input refill for srcFacts.
+
+    refillContent() forwards to the selected engine. For the default engine,
+    a reader thread fills one buffer while the parser works on the other.
+    Each buffer has room in front of the data for the unprocessed prefix
+    of the content, so a refill copies only the prefix. A ContentReader of
+    another file descriptor uses the same reader thread and buffers.
+*/
+
+#include "refillContent.hpp"
+#include "refillUring.hpp"
+#include "refillRing.hpp"
+#include "perfCounters.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <sys/types.h>
+#include <errno.h>
+
+#if !defined(_MSC_VER)
+#include <sys/uio.h>
+#include <unistd.h>
+#define READ read
+#else
+#include <BaseTsd.h>
+#include <io.h>
+typedef SSIZE_T ssize_t;
+#define READ _read
+#endif
+
+namespace {
+
+    // room in front of the data for the unprocessed prefix
+    const int PREFIX_SIZE = BUFFER_SIZE;
+
+    // amount of data read into a buffer, in multiple of whole blocks
+    const int CHUNK_SIZE = BUFFER_SIZE - BLOCK_SIZE;
+
+    struct Buffer {
+        char data[PREFIX_SIZE + CHUNK_SIZE];
+        ssize_t bytesRead = 0;
+        bool ready = false;
+    };
+}
+
+struct ContentReader {
+    int fd = 0;
+    Buffer buffers[2];
+    std::mutex mutex;
+    std::condition_variable filled;
+    std::condition_variable emptied;
+    std::thread thread;
+    // buffer the parser takes next
+    int next = 0;
+    // parser holds the content of the previous buffer
+    bool holding = false;
+    bool done = false;
+    // parser no longer takes buffers, so the rest of the input is read and dropped
+    bool stopping = false;
+};
+
+namespace {
+
+    // reader of the standard input, allocated on first use and never
+    // freed, so the detached reader thread never sees it destroyed at exit
+    ContentReader* reader = nullptr;
+
+    // refill of the selected engine
+    int (*refill)(std::string_view& content) = nullptr;
+
+    // time spent in refillContent()
+    std::chrono::steady_clock::duration waitTime{};
+
+    /*
+        Fill the chunk of a buffer, with a short read only at EOF.
+
+        @param[in] fd File descriptor of the input
+        @param[out] chunk Start of the chunk
+        @return Number of bytes read
+        @retval -1 Read error
+    */
+    ssize_t readChunk(int fd, char* chunk) {
+
+        ssize_t total = 0;
+        while (total < CHUNK_SIZE) {
+            ssize_t bytesRead = 0;
+            while (((bytesRead = READ(fd, chunk + total, CHUNK_SIZE - total)) == -1) && (errno == EINTR)) {
+            }
+            if (bytesRead == -1)
+                return -1;
+            if (bytesRead == 0)
+                break;
+            total += bytesRead;
+        }
+
+        return total;
+    }
+
+    /*
+        Read the input into the buffers in turn until EOF or error.
+
+        @param[in, out] reader Reader of the input
+    */
+    void readInput(ContentReader* reader) {
+
+        for (int current = 0; ; current = 1 - current) {
+            Buffer& buffer = reader->buffers[current];
+            {
+                std::unique_lock<std::mutex> lock(reader->mutex);
+                reader->emptied.wait(lock, [reader, &buffer]{ return !buffer.ready || reader->stopping; });
+            }
+            const ssize_t bytesRead = readChunk(reader->fd, buffer.data + PREFIX_SIZE);
+            {
+                std::lock_guard<std::mutex> lock(reader->mutex);
+                buffer.bytesRead = bytesRead;
+                buffer.ready = true;
+            }
+            reader->filled.notify_one();
+            if (bytesRead <= 0)
+                break;
+        }
+    }
+
+    /*
+        Refill the content preserving the existing data from a reader thread.
+
+        @param[in, out] reader Reader of the input
+        @param[in, out] content View of the content
+        @return Number of bytes read
+        @retval 0 EOF
+        @retval -1 Read error
+    */
+    int refillReader(ContentReader* reader, std::string_view& content) {
+
+        // after EOF or error, the content stays in the last buffer
+        if (reader->done)
+            return 0;
+
+        // wait for the reader to fill the next buffer
+        Buffer& buffer = reader->buffers[reader->next];
+        {
+            std::unique_lock<std::mutex> lock(reader->mutex);
+            reader->filled.wait(lock, [&buffer]{ return buffer.ready; });
+        }
+        if (buffer.bytesRead == -1) {
+            reader->done = true;
+            return -1;
+        }
+        if (content.size() > PREFIX_SIZE) {
+            reader->done = true;
+            return -1;
+        }
+
+        // preserve prefix of unprocessed characters in front of the new data
+        char* start = buffer.data + PREFIX_SIZE - content.size();
+        std::copy(content.cbegin(), content.cend(), start);
+
+        // set content to the start of the prefix
+        content = std::string_view(start, content.size() + buffer.bytesRead);
+
+        if (buffer.bytesRead == 0) {
+            reader->done = true;
+            return 0;
+        }
+
+        // previous buffer is free for the reader
+        if (reader->holding) {
+            Buffer& previous = reader->buffers[1 - reader->next];
+            {
+                std::lock_guard<std::mutex> lock(reader->mutex);
+                previous.ready = false;
+            }
+            reader->emptied.notify_one();
+        }
+        reader->holding = true;
+        reader->next = 1 - reader->next;
+
+        return static_cast<int>(buffer.bytesRead);
+    }
+
+    /*
+        Refill the content preserving the existing data from the reader
+        thread of the standard input.
+
+        @param[in, out] content View of the content
+        @return Number of bytes read
+        @retval 0 EOF
+        @retval -1 Read error
+    */
+    int refillThread(std::string_view& content) {
+
+        // start the reader thread at first use
+        if (!reader) {
+            reader = new ContentReader;
+            reader->thread = std::thread(readInput, reader);
+            reader->thread.detach();
+        }
+
+        return refillReader(reader, content);
+    }
+}
+
+/*
+    Select the engine used by refillContent(). Call before the first refill.
+
+    @param[in] engine Requested engine
+    @return Engine in use, THREAD when the requested engine is unavailable
+*/
+InputEngine selectInputEngine(InputEngine engine) {
+
+    if (engine == InputEngine::URING && startUring(0)) {
+        refill = refillUring;
+        return InputEngine::URING;
+    }
+
+    if (engine == InputEngine::RING && startRing(0)) {
+        refill = refillRing;
+        return InputEngine::RING;
+    }
+
+    refill = refillThread;
+    return InputEngine::THREAD;
+}
+
+/*
+    Refill the content preserving the existing data.
+
+    @param[in, out] content View of the content
+    @return Number of bytes read
+    @retval 0 EOF
+    @retval -1 Read error
+*/
+[[nodiscard]] int refillContent(std::string_view& content) {
+
+    if (!refill)
+        selectInputEngine(InputEngine::THREAD);
+
+    const auto startWait = std::chrono::steady_clock::now();
+    beginPerfWait();
+    const int bytesRead = refill(content);
+    endPerfWait();
+    waitTime += std::chrono::steady_clock::now() - startWait;
+
+    return bytesRead;
+}
+
+/*
+    Time the parser spent waiting in refillContent() for input.
+
+    @return Seconds spent waiting
+*/
+double refillWaitSeconds() {
+
+    return std::chrono::duration_cast<std::chrono::duration<double>>(waitTime).count();
+}
+
+/*
+    Start a reader thread of a file descriptor other than the standard
+    input, e.g., for one file of a multiple-file run, into its own
+    double buffers.
+
+    @param[in] fd File descriptor of the input, closed by stopContentReader()
+    @return Reader of the input
+*/
+ContentReader* startContentReader(int fd) {
+
+    ContentReader* contentReader = new ContentReader;
+    contentReader->fd = fd;
+    contentReader->thread = std::thread(readInput, contentReader);
+
+    return contentReader;
+}
+
+/*
+    Refill the content preserving the existing data from a reader.
+
+    @param[in, out] contentReader Reader of the input
+    @param[in, out] content View of the content
+    @return Number of bytes read
+    @retval 0 EOF
+    @retval -1 Read error
+*/
+[[nodiscard]] int refillContent(ContentReader& contentReader, std::string_view& content) {
+
+    return refillReader(&contentReader, content);
+}
+
+/*
+    Stop a reader thread, after it reads the rest of the input so that a
+    writer of the input, e.g., a decompression thread, is never blocked,
+    and free the reader.
+
+    @param[in] contentReader Reader of the input
+*/
+void stopContentReader(ContentReader* contentReader) {
+
+    {
+        std::lock_guard<std::mutex> lock(contentReader->mutex);
+        contentReader->stopping = true;
+    }
+    contentReader->emptied.notify_one();
+    contentReader->thread.join();
+    close(contentReader->fd);
+    delete contentReader;
+}
@@ -0,0 +1,83 @@
+/*
+    refillContent.hpp
+
+    Refill of the input content for srcFacts. By default, input is read
+    by a background thread into double buffers so that the parser does not
+    wait on read() while content remains. An io_uring engine for regular
+    files, and a magic ring buffer engine that never moves the unprocessed
+    prefix, are selectable.
+*/
+
+#ifndef INCLUDED_REFILLCONTENT_HPP
+#define INCLUDED_REFILLCONTENT_HPP
+
+#include <string_view>
+
+const int BLOCK_SIZE = 4096;
+// size of each read, and the largest prefix a refill preserves. The two buffers of
+// the reader each hold a prefix and a read, about 1 MB in total, so they do not fit
+// in a typical L2. Tokens larger than the prefix are resumed or saved by the parser.
+const int BUFFER_SIZE = 64 * BLOCK_SIZE;
+
+// engines that read the input for refillContent()
+enum class InputEngine { THREAD, URING, RING };
+
+/*
+    Select the engine used by refillContent(). Call before the first refill.
+
+    @param[in] engine Requested engine
+    @return Engine in use, THREAD when the requested engine is unavailable
+*/
+InputEngine selectInputEngine(InputEngine engine);
+
+/*
+    Refill the content preserving the existing data.
+
+    @param[in, out] content View of the content
+    @return Number of bytes read
+    @retval 0 EOF
+    @retval -1 Read error
+*/
+[[nodiscard]] int refillContent(std::string_view& content);
+
+// reader thread of a file descriptor other than the standard input
+struct ContentReader;
+
+/*
+    Start a reader thread of a file descriptor other than the standard
+    input, e.g., for one file of a multiple-file run, into its own
+    double buffers.
+
+    @param[in] fd File descriptor of the input, closed by stopContentReader()
+    @return Reader of the input
+*/
+ContentReader* startContentReader(int fd);
+
+/*
+    Refill the content preserving the existing data from a reader.
+
+    @param[in, out] contentReader Reader of the input
+    @param[in, out] content View of the content
+    @return Number of bytes read
+    @retval 0 EOF
+    @retval -1 Read error
+*/
+[[nodiscard]] int refillContent(ContentReader& contentReader, std::string_view& content);
+
+/*
+    Stop a reader thread, after it reads the rest of the input so that a
+    writer of the input, e.g., a decompression thread, is never blocked,
+    and free the reader.
+
+    @param[in] contentReader Reader of the input
+*/
+void stopContentReader(ContentReader* contentReader);
+
+/*
+    Time the parser spent waiting in refillContent() for input.
+
+    @return Seconds spent waiting
+*/
+double refillWaitSeconds();
+
+#endif
@@ -0,0 +1,183 @@
+/*
+    refillRing.cpp
+
+    Implementation of the magic ring buffer input engine for refillContent().
+
+    A memory file is mapped twice, back to back, followed by a readable
+    page of zeros. It is not a guard against overruns: lookahead past the
+    end of content that ends at the end of the second mapping reads it,
+    as with the page of zeros after mapped content.
+    The reader thread appends input at the write position of the ring, and
+    the parser releases the space before the unprocessed prefix of the
+    content at each refill. Positions are in bytes from the start of the
+    input, so the offset into the ring is the position modulo the ring size.
+*/
+
+#include "refillRing.hpp"
+#include "refillContent.hpp"
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace {
+
+    // size of the ring, a multiple of the page size
+    const long RING_SIZE = 4 * BUFFER_SIZE;
+
+    // most new data given to the parser in one refill
+    const long CHUNK_SIZE = BUFFER_SIZE - BLOCK_SIZE;
+
+    struct Ring {
+        int fd = -1;
+        char* base = nullptr;
+        std::mutex mutex;
+        std::condition_variable filled;
+        std::condition_variable emptied;
+        // position of the end of the input read by the reader thread
+        long long written = 0;
+        // position of the start of the content the parser still holds
+        long long released = 0;
+        // 1 at EOF, -1 on read error
+        int status = 0;
+        // position of the end of the content given to the parser
+        long long end = 0;
+    };
+
+    // allocated once and never freed, so the detached reader
+    // thread never sees it destroyed at exit
+    Ring* ring = nullptr;
+
+    /*
+        Read the input into the free space of the ring until EOF or error.
+    */
+    void readInput() {
+
+        while (true) {
+
+            // wait for at least a block of free space
+            long long position = 0;
+            long space = 0;
+            {
+                std::unique_lock<std::mutex> lock(ring->mutex);
+                ring->emptied.wait(lock, []{ return RING_SIZE - (ring->written - ring->released) >= BLOCK_SIZE; });
+                position = ring->written;
+                space = static_cast<long>(RING_SIZE - (ring->written - ring->released));
+            }
+
+            // the free space is contiguous even when it wraps around the ring
+            ssize_t bytesRead = 0;
+            while (((bytesRead = read(ring->fd, ring->base + position % RING_SIZE, std::min(space, CHUNK_SIZE))) == -1) && (errno == EINTR)) {
+            }
+            {
+                std::lock_guard<std::mutex> lock(ring->mutex);
+                if (bytesRead > 0)
+                    ring->written += bytesRead;
+                else
+                    ring->status = bytesRead == 0 ? 1 : -1;
+            }
+            ring->filled.notify_one();
+            if (bytesRead <= 0)
+                break;
+        }
+    }
+}
+
+/*
+    Setup the ring buffer mappings and start the reader thread.
+
+    @param[in] fd File descriptor of the input
+    @return If the engine started
+    @retval false Ring buffer mappings are unavailable
+*/
+bool startRing(int fd) {
+
+    const int memfd = memfd_create("srcfacts-ring", 0);
+    if (memfd == -1)
+        return false;
+    if (ftruncate(memfd, RING_SIZE) == -1) {
+        close(memfd);
+        return false;
+    }
+
+    // reserve the address range for both mappings and the page of zeros for lookahead
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    void* region = mmap(nullptr, 2 * RING_SIZE + pageSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        close(memfd);
+        return false;
+    }
+    char* base = static_cast<char*>(region);
+    if (mmap(base, RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memfd, 0) == MAP_FAILED ||
+        mmap(base + RING_SIZE, RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, memfd, 0) == MAP_FAILED) {
+        munmap(region, 2 * RING_SIZE + pageSize);
+        close(memfd);
+        return false;
+    }
+    // mappings keep the memory file
+    close(memfd);
+
+    ring = new Ring;
+    ring->fd = fd;
+    ring->base = base;
+    std::thread(readInput).detach();
+
+    return true;
+}
+
+/*
+    Refill the content preserving the existing data in place in the ring buffer.
+
+    @param[in, out] content View of the content
+    @return Number of bytes read
+    @retval 0 EOF
+    @retval -1 Read error
+*/
+[[nodiscard]] int refillRing(std::string_view& content) {
+
+    // the reader needs free space to make progress
+    if (content.size() > RING_SIZE - BLOCK_SIZE)
+        return -1;
+
+    // release the space before the unprocessed prefix, and wait for new input
+    const long long start = ring->end - content.size();
+    long long written = 0;
+    int status = 0;
+    {
+        std::unique_lock<std::mutex> lock(ring->mutex);
+        ring->released = start;
+        ring->emptied.notify_one();
+        ring->filled.wait(lock, [] { return ring->written > ring->end || ring->status != 0; });
+        written = ring->written;
+        status = ring->status;
+    }
+    if (written == ring->end)
+        return status == 1 ? 0 : -1;
+
+    // content starts in the first mapping, and may continue into the second
+    const long long newEnd = std::min(written, ring->end + CHUNK_SIZE);
+    const int bytesRead = static_cast<int>(newEnd - ring->end);
+    content = std::string_view(ring->base + start % RING_SIZE, newEnd - start);
+    ring->end = newEnd;
+
+    return bytesRead;
+}
+
+#else
+
+bool startRing(int) {
+    return false;
+}
+
+[[nodiscard]] int refillRing(std::string_view&) {
+    return -1;
+}
+
+#endif
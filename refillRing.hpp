@@ -0,0 +1,34 @@
+/*
+    refillRing.hpp
+
+    Magic ring buffer input engine for refillContent(). The same physical
+    pages are mapped twice, back to back, so content that wraps around the
+    end of the ring is still one contiguous view, and a refill never moves
+    the unprocessed prefix.
+*/
+
+#ifndef INCLUDED_REFILLRING_HPP
+#define INCLUDED_REFILLRING_HPP
+
+#include <string_view>
+
+/*
+    Setup the ring buffer mappings and start the reader thread.
+
+    @param[in] fd File descriptor of the input
+    @return If the engine started
+    @retval false Ring buffer mappings are unavailable
+*/
+bool startRing(int fd);
+
+/*
+    Refill the content preserving the existing data in place in the ring buffer.
+
+    @param[in, out] content View of the content
+    @return Number of bytes read
+    @retval 0 EOF
+    @retval -1 Read error
+*/
+[[nodiscard]] int refillRing(std::string_view& content);
+
+#endif
@@ -0,0 +1,308 @@
+/*
+    refillUring.cpp
+
+    Implementation of the io_uring input engine for refillContent().
+
+    The input is read in chunks at explicit offsets into a fixed set of
+    buffers, with a read in flight for every buffer the parser does not
+    hold. Each buffer has room in front of the data for the unprocessed
+    prefix of the content. The ring is setup directly with the system
+    calls, so there is no dependency on liburing.
+*/
+
+#include "refillUring.hpp"
+#include "refillContent.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+    // number of reads in flight, plus the buffer the parser holds
+    const int QUEUE_DEPTH = 4;
+
+    // room in front of the data for the unprocessed prefix
+    const int PREFIX_SIZE = BUFFER_SIZE;
+
+    // amount of data read into a buffer, in multiple of whole blocks
+    const int CHUNK_SIZE = BUFFER_SIZE - BLOCK_SIZE;
+
+    struct Buffer {
+        alignas(BLOCK_SIZE) char data[PREFIX_SIZE + CHUNK_SIZE];
+        struct iovec iov;
+        off_t offset = 0;
+        int result = 0;
+        bool submitted = false;
+        bool completed = false;
+    };
+
+    struct Ring {
+        int ringfd = -1;
+        int fd = -1;
+        off_t fileSize = 0;
+        off_t nextOffset = 0;
+
+        // submission queue
+        unsigned* sqTail = nullptr;
+        unsigned* sqMask = nullptr;
+        unsigned* sqArray = nullptr;
+        struct io_uring_sqe* sqes = nullptr;
+
+        // completion queue
+        unsigned* cqHead = nullptr;
+        unsigned* cqTail = nullptr;
+        unsigned* cqMask = nullptr;
+        struct io_uring_cqe* cqes = nullptr;
+
+        Buffer buffers[QUEUE_DEPTH];
+        // buffer the parser takes next
+        int next = 0;
+        // parser holds the content of the previous buffer
+        bool holding = false;
+    };
+
+    Ring* ring = nullptr;
+
+    // atomic access to the ring indices shared with the kernel
+    unsigned loadAcquire(const unsigned* p) {
+        return reinterpret_cast<const std::atomic<unsigned>*>(p)->load(std::memory_order_acquire);
+    }
+
+    void storeRelease(unsigned* p, unsigned value) {
+        reinterpret_cast<std::atomic<unsigned>*>(p)->store(value, std::memory_order_release);
+    }
+
+    /*
+        Submit a read of the next chunk of the input into a buffer.
+
+        @param[in] index Index of the buffer
+        @return If the read was submitted
+    */
+    bool submitRead(int index) {
+
+        Buffer& buffer = ring->buffers[index];
+        buffer.completed = false;
+        buffer.submitted = false;
+        if (ring->nextOffset >= ring->fileSize)
+            return true;
+
+        buffer.offset = ring->nextOffset;
+        ring->nextOffset += CHUNK_SIZE;
+        buffer.iov.iov_base = buffer.data + PREFIX_SIZE;
+        buffer.iov.iov_len = CHUNK_SIZE;
+
+        const unsigned tail = *ring->sqTail;
+        const unsigned slot = tail & *ring->sqMask;
+        struct io_uring_sqe* sqe = &ring->sqes[slot];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = ring->fd;
+        sqe->off = buffer.offset;
+        sqe->addr = reinterpret_cast<unsigned long>(&buffer.iov);
+        sqe->len = 1;
+        sqe->user_data = index;
+        ring->sqArray[slot] = slot;
+        storeRelease(ring->sqTail, tail + 1);
+
+        int submitted = 0;
+        while ((submitted = syscall(__NR_io_uring_enter, ring->ringfd, 1, 0, 0, nullptr, 0)) == -1 && errno == EINTR) {
+        }
+        if (submitted != 1)
+            return false;
+        buffer.submitted = true;
+
+        return true;
+    }
+
+    /*
+        Wait for the read into a buffer to complete.
+
+        @param[in] index Index of the buffer
+        @return If the read completed
+    */
+    bool waitRead(int index) {
+
+        Buffer& buffer = ring->buffers[index];
+        while (!buffer.completed) {
+
+            // reap all available completions
+            unsigned head = *ring->cqHead;
+            const unsigned tail = loadAcquire(ring->cqTail);
+            for (; head != tail; ++head) {
+                const struct io_uring_cqe& cqe = ring->cqes[head & *ring->cqMask];
+                Buffer& completed = ring->buffers[cqe.user_data];
+                completed.result = cqe.res;
+                completed.completed = true;
+            }
+            storeRelease(ring->cqHead, head);
+            if (buffer.completed)
+                break;
+
+            if (syscall(__NR_io_uring_enter, ring->ringfd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) == -1 && errno != EINTR)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+/*
+    Setup the io_uring submission ring and start reads of the input.
+
+    @param[in] fd File descriptor of the input
+    @return If the engine started
+    @retval false io_uring is unavailable, or the input is not a regular file
+*/
+bool startUring(int fd) {
+
+    // reads at explicit offsets require a regular file
+    struct stat status;
+    if (fstat(fd, &status) == -1 || !S_ISREG(status.st_mode))
+        return false;
+    const off_t startOffset = lseek(fd, 0, SEEK_CUR);
+    if (startOffset == -1)
+        return false;
+
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const int ringfd = syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params);
+    if (ringfd == -1)
+        return false;
+
+    // map the submission and completion queue rings, and the submission entries
+    std::size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    std::size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap)
+        sqSize = cqSize = std::max(sqSize, cqSize);
+    void* sqRing = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        close(ringfd);
+        return false;
+    }
+    void* cqRing = sqRing;
+    if (!singleMap) {
+        cqRing = mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            munmap(sqRing, sqSize);
+            close(ringfd);
+            return false;
+        }
+    }
+    void* sqes = mmap(nullptr, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        munmap(sqRing, sqSize);
+        if (!singleMap)
+            munmap(cqRing, cqSize);
+        close(ringfd);
+        return false;
+    }
+
+    ring = new Ring;
+    ring->ringfd = ringfd;
+    ring->fd = fd;
+    ring->fileSize = status.st_size;
+    ring->nextOffset = startOffset;
+    char* sq = static_cast<char*>(sqRing);
+    ring->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->sqes = static_cast<struct io_uring_sqe*>(sqes);
+    char* cq = static_cast<char*>(cqRing);
+    ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // fill the queue
+    for (int i = 0; i < QUEUE_DEPTH; ++i) {
+        if (!submitRead(i)) {
+            // reads already in flight may still target the buffers, so the
+            // ring is abandoned instead of freed, and read() takes over
+            ring = nullptr;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+    Refill the content preserving the existing data from the io_uring reads.
+
+    @param[in, out] content View of the content
+    @return Number of bytes read
+    @retval 0 EOF
+    @retval -1 Read error
+*/
+[[nodiscard]] int refillUring(std::string_view& content) {
+
+    Buffer& buffer = ring->buffers[ring->next];
+
+    // no read means the whole file was read
+    if (!buffer.submitted)
+        return 0;
+
+    if (!waitRead(ring->next) || buffer.result < 0)
+        return -1;
+
+    // complete a short read before the end of the file
+    ssize_t bytesRead = buffer.result;
+    const ssize_t expected = std::min<off_t>(CHUNK_SIZE, ring->fileSize - buffer.offset);
+    while (bytesRead > 0 && bytesRead < expected) {
+        ssize_t more = 0;
+        while ((more = pread(ring->fd, buffer.data + PREFIX_SIZE + bytesRead, expected - bytesRead, buffer.offset + bytesRead)) == -1 && errno == EINTR) {
+        }
+        if (more == -1)
+            return -1;
+        if (more == 0)
+            break;
+        bytesRead += more;
+    }
+
+    if (content.size() > PREFIX_SIZE)
+        return -1;
+
+    // preserve prefix of unprocessed characters in front of the new data
+    char* start = buffer.data + PREFIX_SIZE - content.size();
+    std::copy(content.cbegin(), content.cend(), start);
+
+    // set content to the start of the prefix
+    content = std::string_view(start, content.size() + bytesRead);
+
+    if (bytesRead == 0) {
+        buffer.submitted = false;
+        return 0;
+    }
+
+    // previous buffer is free for the next read
+    const int previous = (ring->next + QUEUE_DEPTH - 1) % QUEUE_DEPTH;
+    if (ring->holding && !submitRead(previous))
+        return -1;
+    ring->holding = true;
+    ring->next = (ring->next + 1) % QUEUE_DEPTH;
+
+    return static_cast<int>(bytesRead);
+}
+
+#else
+
+bool startUring(int) {
+    return false;
+}
+
+[[nodiscard]] int refillUring(std::string_view&) {
+    return -1;
+}
+
+#endif
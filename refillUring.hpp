@@ -0,0 +1,32 @@
+/*
+    refillUring.hpp
+
+    io_uring input engine for refillContent(). Several block-aligned reads
+    of a regular file are kept in flight ahead of the parser.
+*/
+
+#ifndef INCLUDED_REFILLURING_HPP
+#define INCLUDED_REFILLURING_HPP
+
+#include <string_view>
+
+/*
+    Setup the io_uring submission ring and start reads of the input.
+
+    @param[in] fd File descriptor of the input
+    @return If the engine started
+    @retval false io_uring is unavailable, or the input is not a regular file
+*/
+bool startUring(int fd);
+
+/*
+    Refill the content preserving the existing data from the io_uring reads.
+
+    @param[in, out] content View of the content
+    @return Number of bytes read
+    @retval 0 EOF
+    @retval -1 Read error
+*/
+[[nodiscard]] int refillUring(std::string_view& content);
+
+#endif
@@ -0,0 +1,459 @@
+/*
+    scanContent.cpp
+
+    Implementation of the scanning kernels for the XML parser in srcFacts.
+
+    The kernel for each scan is selected once, at static initialization,
+    from the features of the CPU.
+*/
+
+#include "scanContent.hpp"
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    using FindCharactersEnd = std::size_t (*)(std::string_view content, int& newlines);
+    using CountNewlines = int (*)(std::string_view characters);
+    using FindInSet = std::size_t (*)(std::string_view content);
+    using FindElementEnd = std::size_t (*)(std::string_view content, std::size_t pos, int& nesting);
+
+    /*
+        Nibble lookup tables for a character class over ASCII. Each bit of
+        a lo entry is a high nibble, and each hi entry is the bit of its
+        high nibble, so a character is in the class when the lo entry of
+        its low nibble and the hi entry of its high nibble share a bit.
+    */
+    struct NibbleTable {
+        alignas(16) unsigned char lo[16] = {};
+        alignas(16) unsigned char hi[16] = {};
+    };
+
+    constexpr NibbleTable makeNibbleTable(unsigned char characterClass) {
+
+        NibbleTable table;
+        for (int h = 0; h < 8; ++h)
+            table.hi[h] = static_cast<unsigned char>(1 << h);
+        for (int c = 0; c < 0x80; ++c) {
+            if (CHARACTER_CLASS[c] & characterClass)
+                table.lo[c & 0x0F] |= static_cast<unsigned char>(1 << (c >> 4));
+        }
+
+        return table;
+    }
+
+    template <unsigned char characterClass>
+    constexpr NibbleTable nibbleTable = makeNibbleTable(characterClass);
+
+    // scalar kernels
+
+    std::size_t findCharactersEndScalar(std::string_view content, int& newlines) {
+
+        int count = 0;
+        for (std::size_t i = 0; i < content.size(); ++i) {
+            const char c = content[i];
+            if (isCharacterClass(c, CHARACTERS_END_CHAR)) {
+                newlines = count;
+                return i;
+            }
+            count += c == '\n';
+        }
+        newlines = count;
+
+        return content.npos;
+    }
+
+    int countNewlinesScalar(std::string_view characters) {
+
+        return static_cast<int>(std::count(characters.cbegin(), characters.cend(), '\n'));
+    }
+
+    template <unsigned char characterClass, bool inSet>
+    std::size_t findScalar(std::string_view content) {
+
+        for (std::size_t i = 0; i < content.size(); ++i) {
+            if (isCharacterClass(content[i], characterClass) == inSet)
+                return i;
+        }
+
+        return content.npos;
+    }
+
+    /*
+        Count the tag at a position for findElementEnd(). A '<' is counted
+        with its next byte, and a '>' with its previous byte.
+
+        @return If the scan stops at the position
+    */
+    inline bool countElementTag(std::string_view content, std::size_t i, int& nesting) {
+
+        if (content[i] == '<' && i + 1 < content.size()) {
+            const char next = content[i + 1];
+            if (next == '!' || next == '?')
+                return true;
+            if (next != '/') {
+                ++nesting;
+            } else {
+                if (nesting <= 0)
+                    return true;
+                --nesting;
+            }
+        } else if (content[i] == '>' && i > 0 && content[i - 1] == '/') {
+            --nesting;
+        }
+
+        return false;
+    }
+
+    std::size_t findElementEndScalar(std::string_view content, std::size_t pos, int& nesting) {
+
+        for (std::size_t i = pos; i < content.size(); ++i) {
+            if (countElementTag(content, i, nesting))
+                return i;
+        }
+
+        return content.npos;
+    }
+
+    /*
+        Count the tags of a block of findElementEnd() from the masks of its
+        start tags, end tags, empty-element tags, and "<!" or "<?". When
+        no end tag can close the current element, only the counts matter.
+
+        @return Offset in the block where the scan stops
+        @retval -1 Scan continues
+    */
+    inline int countElementTags(unsigned starts, unsigned ends, unsigned empties, unsigned others, int& nesting) {
+
+        const int closes = __builtin_popcount(ends) + __builtin_popcount(empties);
+        if (!others && nesting >= closes) {
+            nesting += __builtin_popcount(starts) - closes;
+            return -1;
+        }
+        for (unsigned tags = starts | ends | empties | others; tags; tags &= tags - 1) {
+            const int offset = __builtin_ctz(tags);
+            const unsigned tag = 1u << offset;
+            if (starts & tag) {
+                ++nesting;
+            } else if (empties & tag) {
+                --nesting;
+            } else if ((ends & tag) && nesting > 0) {
+                --nesting;
+            } else {
+                return offset;
+            }
+        }
+
+        return -1;
+    }
+
+#ifdef SCAN_X86
+
+    // SSE4.2 kernels, 16 bytes at a time
+
+    __attribute__((target("sse4.2,popcnt")))
+    std::size_t findCharactersEndSSE42(std::string_view content, int& newlines) {
+
+        const __m128i lt = _mm_set1_epi8('<');
+        const __m128i amp = _mm_set1_epi8('&');
+        const __m128i nl = _mm_set1_epi8('\n');
+        int count = 0;
+        std::size_t i = 0;
+        for (; i + 16 <= content.size(); i += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(content.data() + i));
+            const unsigned stops = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, lt), _mm_cmpeq_epi8(block, amp)));
+            const unsigned lines = _mm_movemask_epi8(_mm_cmpeq_epi8(block, nl));
+            if (stops) {
+                const int end = __builtin_ctz(stops);
+                newlines = count + _mm_popcnt_u32(lines & ((1u << end) - 1));
+                return i + end;
+            }
+            count += _mm_popcnt_u32(lines);
+        }
+        int tailNewlines = 0;
+        const std::size_t end = findCharactersEndScalar(content.substr(i), tailNewlines);
+        newlines = count + tailNewlines;
+
+        return end == content.npos ? end : i + end;
+    }
+
+    __attribute__((target("sse4.2,popcnt")))
+    int countNewlinesSSE42(std::string_view characters) {
+
+        const __m128i nl = _mm_set1_epi8('\n');
+        int count = 0;
+        std::size_t i = 0;
+        for (; i + 16 <= characters.size(); i += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(characters.data() + i));
+            count += _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi8(block, nl)));
+        }
+
+        return count + countNewlinesScalar(characters.substr(i));
+    }
+
+    template <unsigned char characterClass, bool inSet>
+    __attribute__((target("sse4.2,popcnt")))
+    std::size_t findSSE42(std::string_view content) {
+
+        const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(nibbleTable<characterClass>.lo));
+        const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(nibbleTable<characterClass>.hi));
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        std::size_t i = 0;
+        for (; i + 16 <= content.size(); i += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(content.data() + i));
+            const __m128i loBits = _mm_shuffle_epi8(lo, _mm_and_si128(block, nibble));
+            const __m128i hiBits = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(block, 4), nibble));
+            const unsigned outside = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(loBits, hiBits), _mm_setzero_si128()));
+            const unsigned found = inSet ? ~outside & 0xFFFF : outside;
+            if (found)
+                return i + __builtin_ctz(found);
+        }
+        const std::size_t end = findScalar<characterClass, inSet>(content.substr(i));
+
+        return end == content.npos ? end : i + end;
+    }
+
+    __attribute__((target("sse4.2,popcnt")))
+    std::size_t findElementEndSSE42(std::string_view content, std::size_t pos, int& nesting) {
+
+        // the first byte has no previous byte for the vector of previous bytes
+        if (pos == 0 && !content.empty()) {
+            if (countElementTag(content, 0, nesting))
+                return 0;
+            pos = 1;
+        }
+        const __m128i lt = _mm_set1_epi8('<');
+        const __m128i gt = _mm_set1_epi8('>');
+        const __m128i slash = _mm_set1_epi8('/');
+        const __m128i bang = _mm_set1_epi8('!');
+        const __m128i question = _mm_set1_epi8('?');
+        std::size_t i = pos;
+        for (; i + 16 + 1 <= content.size(); i += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(content.data() + i));
+            const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(content.data() + i + 1));
+            const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(content.data() + i - 1));
+            const unsigned opens = _mm_movemask_epi8(_mm_cmpeq_epi8(block, lt));
+            const unsigned nextSlash = _mm_movemask_epi8(_mm_cmpeq_epi8(next, slash));
+            const unsigned nextOther = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(next, bang), _mm_cmpeq_epi8(next, question)));
+            const unsigned empties = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block, gt), _mm_cmpeq_epi8(previous, slash)));
+            const int offset = countElementTags(opens & ~nextSlash & ~nextOther, opens & nextSlash, empties, opens & nextOther, nesting);
+            if (offset != -1)
+                return i + offset;
+        }
+
+        return findElementEndScalar(content, i, nesting);
+    }
+
+    // AVX2 kernels, 32 bytes at a time
+
+    __attribute__((target("avx2,popcnt")))
+    std::size_t findCharactersEndAVX2(std::string_view content, int& newlines) {
+
+        const __m256i lt = _mm256_set1_epi8('<');
+        const __m256i amp = _mm256_set1_epi8('&');
+        const __m256i nl = _mm256_set1_epi8('\n');
+        int count = 0;
+        std::size_t i = 0;
+        for (; i + 32 <= content.size(); i += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(content.data() + i));
+            const unsigned stops = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, lt), _mm256_cmpeq_epi8(block, amp)));
+            const unsigned lines = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, nl));
+            if (stops) {
+                const int end = __builtin_ctz(stops);
+                newlines = count + _mm_popcnt_u32(lines & ((1u << end) - 1));
+                return i + end;
+            }
+            count += _mm_popcnt_u32(lines);
+        }
+        int tailNewlines = 0;
+        const std::size_t end = findCharactersEndSSE42(content.substr(i), tailNewlines);
+        newlines = count + tailNewlines;
+
+        return end == content.npos ? end : i + end;
+    }
+
+    __attribute__((target("avx2,popcnt")))
+    int countNewlinesAVX2(std::string_view characters) {
+
+        const __m256i nl = _mm256_set1_epi8('\n');
+        int count = 0;
+        std::size_t i = 0;
+        for (; i + 32 <= characters.size(); i += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(characters.data() + i));
+            count += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, nl)));
+        }
+
+        return count + countNewlinesSSE42(characters.substr(i));
+    }
+
+    template <unsigned char characterClass, bool inSet>
+    __attribute__((target("avx2,popcnt")))
+    std::size_t findAVX2(std::string_view content) {
+
+        const __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(nibbleTable<characterClass>.lo)));
+        const __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(nibbleTable<characterClass>.hi)));
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        std::size_t i = 0;
+        for (; i + 32 <= content.size(); i += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(content.data() + i));
+            const __m256i loBits = _mm256_shuffle_epi8(lo, _mm256_and_si256(block, nibble));
+            const __m256i hiBits = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+            const unsigned outside = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(loBits, hiBits), _mm256_setzero_si256()));
+            const unsigned found = inSet ? ~outside : outside;
+            if (found)
+                return i + __builtin_ctz(found);
+        }
+        const std::size_t end = findSSE42<characterClass, inSet>(content.substr(i));
+
+        return end == content.npos ? end : i + end;
+    }
+
+    __attribute__((target("avx2,popcnt")))
+    std::size_t findElementEndAVX2(std::string_view content, std::size_t pos, int& nesting) {
+
+        // the first byte has no previous byte for the vector of previous bytes
+        if (pos == 0 && !content.empty()) {
+            if (countElementTag(content, 0, nesting))
+                return 0;
+            pos = 1;
+        }
+        const __m256i lt = _mm256_set1_epi8('<');
+        const __m256i gt = _mm256_set1_epi8('>');
+        const __m256i slash = _mm256_set1_epi8('/');
+        const __m256i bang = _mm256_set1_epi8('!');
+        const __m256i question = _mm256_set1_epi8('?');
+        std::size_t i = pos;
+        for (; i + 32 + 1 <= content.size(); i += 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(content.data() + i));
+            const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(content.data() + i + 1));
+            const __m256i previous = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(content.data() + i - 1));
+            const unsigned opens = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, lt));
+            const unsigned nextSlash = _mm256_movemask_epi8(_mm256_cmpeq_epi8(next, slash));
+            const unsigned nextOther = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(next, bang), _mm256_cmpeq_epi8(next, question)));
+            const unsigned empties = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block, gt), _mm256_cmpeq_epi8(previous, slash)));
+            const int offset = countElementTags(opens & ~nextSlash & ~nextOther, opens & nextSlash, empties, opens & nextOther, nesting);
+            if (offset != -1)
+                return i + offset;
+        }
+
+        return findElementEndSSE42(content, i, nesting);
+    }
+
+#endif
+
+    // kernel selection from the CPU features
+
+    enum class Kernel { SCALAR, SSE42, AVX2 };
+
+    Kernel selectKernel() {
+
+#ifdef SCAN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+            return Kernel::AVX2;
+        if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+            return Kernel::SSE42;
+#endif
+        return Kernel::SCALAR;
+    }
+
+    const Kernel kernel = selectKernel();
+
+#ifdef SCAN_X86
+    const FindCharactersEnd findCharactersEndKernel = kernel == Kernel::AVX2  ? findCharactersEndAVX2  :
+                                                      kernel == Kernel::SSE42 ? findCharactersEndSSE42 :
+                                                                                findCharactersEndScalar;
+    const CountNewlines countNewlinesKernel = kernel == Kernel::AVX2  ? countNewlinesAVX2  :
+                                              kernel == Kernel::SSE42 ? countNewlinesSSE42 :
+                                                                        countNewlinesScalar;
+    const FindInSet findNameEndKernel = kernel == Kernel::AVX2  ? findAVX2<NAMEEND_CHAR, true>  :
+                                        kernel == Kernel::SSE42 ? findSSE42<NAMEEND_CHAR, true> :
+                                                                  findScalar<NAMEEND_CHAR, true>;
+    const FindInSet findNonWhitespaceKernel = kernel == Kernel::AVX2  ? findAVX2<WHITESPACE_CHAR, false>  :
+                                              kernel == Kernel::SSE42 ? findSSE42<WHITESPACE_CHAR, false> :
+                                                                        findScalar<WHITESPACE_CHAR, false>;
+    const FindElementEnd findElementEndKernel = kernel == Kernel::AVX2  ? findElementEndAVX2  :
+                                                kernel == Kernel::SSE42 ? findElementEndSSE42 :
+                                                                          findElementEndScalar;
+#else
+    const FindCharactersEnd findCharactersEndKernel = findCharactersEndScalar;
+    const CountNewlines countNewlinesKernel = countNewlinesScalar;
+    const FindInSet findNameEndKernel = findScalar<NAMEEND_CHAR, true>;
+    const FindInSet findNonWhitespaceKernel = findScalar<WHITESPACE_CHAR, false>;
+    const FindElementEnd findElementEndKernel = findElementEndScalar;
+#endif
+}
+
+/*
+    Find the end of character data, i.e., the next '<' or '&', and count
+    the newlines before it in the same pass.
+
+    @param[in] content View of the content
+    @param[out] newlines Number of newlines before the end
+    @return Position of the next '<' or '&'
+    @retval content.npos No '<' or '&' in the content
+*/
+std::size_t findCharactersEnd(std::string_view content, int& newlines) {
+
+    return findCharactersEndKernel(content, newlines);
+}
+
+/*
+    Count the newlines in the characters.
+
+    @param[in] characters View of the characters
+    @return Number of newlines
+*/
+int countNewlines(std::string_view characters) {
+
+    return countNewlinesKernel(characters);
+}
+
+/*
+    Find the end of a name, i.e., the next character in NAMEEND.
+
+    @param[in] content View of the content
+    @param[in] pos Position to start the search
+    @return Position of the next character in NAMEEND
+    @retval content.npos No character of NAMEEND in the content
+*/
+std::size_t findNameEnd(std::string_view content, std::size_t pos) {
+
+    if (pos > content.size())
+        return content.npos;
+
+    const std::size_t end = findNameEndKernel(content.substr(pos));
+
+    return end == content.npos ? end : pos + end;
+}
+
+/*
+    Find the next character that is not whitespace.
+
+    @param[in] content View of the content
+    @return Position of the next character not in WHITESPACE
+    @retval content.npos Content is all whitespace
+*/
+std::size_t findNonWhitespace(std::string_view content) {
+
+    return findNonWhitespaceKernel(content);
+}
+
+/*
+    Find the end tag of the current element by counting only start tags,
+    end tags, and empty-element tags, i.e., "<", "</", and "/>", without
+    their names or attributes.
+
+    @param[in] content View of the content
+    @param[in, out] nesting Number of elements open inside of the current element
+    @return Position of the "</" of the end tag of the current element, or of the next "<!" or "<?"
+    @retval content.npos Neither before the last byte of the content
+*/
+std::size_t findElementEnd(std::string_view content, int& nesting) {
+
+    return findElementEndKernel(content, 0, nesting);
+}
@@ -0,0 +1,127 @@
+/*
+    scanContent.hpp
+
+    Scanning kernels for the XML parser in srcFacts. Each kernel has a
+    scalar version, and on x86 SSE4.2 and AVX2 versions selected at
+    runtime by the features of the CPU. Character sets are classified
+    with nibble lookup tables, i.e., pshufb.
+*/
+
+#ifndef INCLUDED_SCANCONTENT_HPP
+#define INCLUDED_SCANCONTENT_HPP
+
+#include <string_view>
+#include <cstddef>
+#include <array>
+
+/*
+    Find the end of character data, i.e., the next '<' or '&', and count
+    the newlines before it in the same pass.
+
+    @param[in] content View of the content
+    @param[out] newlines Number of newlines before the end
+    @return Position of the next '<' or '&'
+    @retval content.npos No '<' or '&' in the content
+*/
+std::size_t findCharactersEnd(std::string_view content, int& newlines);
+
+/*
+    Count the newlines in the characters.
+
+    @param[in] characters View of the characters
+    @return Number of newlines
+*/
+int countNewlines(std::string_view characters);
+
+// characters that end a name
+constexpr std::string_view NAMEEND = "> /\":=\n\t\r";
+
+// whitespace characters
+constexpr std::string_view WHITESPACE = " \n\t\r";
+
+// classes of a character, as bits of an entry in CHARACTER_CLASS
+enum CharacterClass : unsigned char {
+    NAME_START_CHAR = 1 << 0,
+    NAME_CHAR = 1 << 1,
+    WHITESPACE_CHAR = 1 << 2,
+    NAMEEND_CHAR = 1 << 3,
+    CHARACTERS_END_CHAR = 1 << 4,
+};
+
+/*
+    Classes of every byte value. Bytes of multibyte UTF-8 characters
+    are name characters.
+*/
+constexpr std::array<unsigned char, 256> makeCharacterClasses() {
+
+    std::array<unsigned char, 256> classes{};
+    for (int c = 0; c < 256; ++c) {
+        const bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        const bool digit = c >= '0' && c <= '9';
+        if (letter || c == '_' || c >= 0x80)
+            classes[c] |= NAME_START_CHAR | NAME_CHAR;
+        if (digit || c == '-' || c == '.')
+            classes[c] |= NAME_CHAR;
+        if (c == '<' || c == '&')
+            classes[c] |= CHARACTERS_END_CHAR;
+    }
+    for (const char c : WHITESPACE)
+        classes[static_cast<unsigned char>(c)] |= WHITESPACE_CHAR;
+    for (const char c : NAMEEND)
+        classes[static_cast<unsigned char>(c)] |= NAMEEND_CHAR;
+
+    return classes;
+}
+
+inline constexpr std::array<unsigned char, 256> CHARACTER_CLASS = makeCharacterClasses();
+
+/*
+    Check the class of a character with a single table load.
+
+    @param[in] c Character
+    @param[in] characterClass Bits of CharacterClass
+    @return If the character is in any of the classes
+*/
+constexpr bool isCharacterClass(char c, unsigned char characterClass) {
+
+    return CHARACTER_CLASS[static_cast<unsigned char>(c)] & characterClass;
+}
+
+/*
+    Find the end of a name, i.e., the next character in NAMEEND.
+
+    @param[in] content View of the content
+    @param[in] pos Position to start the search
+    @return Position of the next character in NAMEEND
+    @retval content.npos No character of NAMEEND in the content
+*/
+std::size_t findNameEnd(std::string_view content, std::size_t pos = 0);
+
+/*
+    Find the next character that is not whitespace.
+
+    @param[in] content View of the content
+    @return Position of the next character not in WHITESPACE
+    @retval content.npos Content is all whitespace
+*/
+std::size_t findNonWhitespace(std::string_view content);
+
+/*
+    Find the end tag of the current element by counting only start tags,
+    end tags, and empty-element tags, i.e., "<", "</", and "/>", without
+    their names or attributes. A '>' in characters or attribute values is
+    taken to be escaped, as srcML does. The scan stops at a comment, CDATA,
+    or processing instruction, i.e., "<!" or "<?", for the caller to skip
+    whole, since their contents are not markup.
+
+    A '<' in the last byte of the content is not counted, since the byte
+    after it may not be read yet, so a refill keeps the last byte.
+
+    @param[in] content View of the content
+    @param[in, out] nesting Number of elements open inside of the current element
+    @return Position of the "</" of the end tag of the current element, or of the next "<!" or "<?"
+    @retval content.npos Neither before the last byte of the content
+*/
+std::size_t findElementEnd(std::string_view content, int& nesting);
+
+#endif
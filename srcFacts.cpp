@@ -6,636 +6,531 @@
     and output is a markdown table with the measures. Performance statistics
     are output to standard error.
 
-    The code includes a complete XML parser:
-    * Characters and content from XML is in UTF-8
-    * DTD declarations are allowed, but not fine-grained parsed
-    * No checking for well-formedness
+    The measures are collected by SrcFactsHandler from the events of the
+    complete XML parser, XMLParser. With --jobs, a mapped srcML archive
+    is parsed in parallel at unit boundaries, and with --speculative any
+    mapped document is parsed in parallel from equal chunks.
+
+    Multiple files, and directories of srcML files, are parsed on a
+    work-stealing thread pool, largest file first, with a report for
+    each file and an aggregate report.
+
+    With --ndjson, the output is instead a line of JSON with the measures
+    of each unit, written as the unit ends.
+
+    With --cache, the measures of units are kept in a file by their hash
+    attribute, and a unit already in the cache is skipped, not parsed.
+
+    With --exclude, the units with a filename that matches a pattern are
+    skipped to their end tag by only counting tags, and are not measured.
+    Likewise with --language, units in other languages are skipped, and
+    with --by-language the measures are also reported for each language.
+
+    When built with TOKEN_STATS, the number, bytes, and time of each type
+    of token of the parser are output to standard error.
+
+    With --trace, the parsing events are recorded into a binary trace
+    file, decoded by tracedecode.
+
+    With --perf-stats, hardware performance counters of the run, split
+    into waiting for input and parsing, are output to standard error.
+
+    Compressed input, gzip, zip, or zstd, is detected from its magic bytes
+    and decompressed on its own thread as it is parsed.
 */
 
 #include <iostream>
 #include <locale>
-#include <iterator>
 #include <string>
 #include <algorithm>
-#include <sys/types.h>
-#include <errno.h>
 #include <string_view>
-#include <optional>
 #include <iomanip>
 #include <cmath>
-#include <algorithm>
 #include <chrono>
-#include <memory>
-#include <stdlib.h>
-#include <bitset>
-#include <cassert>
+#include <thread>
+#include <cstdlib>
+#include <vector>
+#include <iterator>
+#include <filesystem>
+#include <system_error>
+#include "refillContent.hpp"
+#include "mapContent.hpp"
+#include "decompressContent.hpp"
+#include "xmlParser.hpp"
+#include "parallelParser.hpp"
+#include "workStealingPool.hpp"
+#include "srcFactsHandler.hpp"
+#include "unitCache.hpp"
+#include "perfCounters.hpp"
+#include "tokenStats.hpp"
+#include "traceEvents.hpp"
 
 #if !defined(_MSC_VER)
-#include <sys/uio.h>
+#include <fcntl.h>
 #include <unistd.h>
-#define READ read
 #else
-#include <BaseTsd.h>
 #include <io.h>
-typedef SSIZE_T ssize_t;
-#define READ _read
 #endif
 
+
 // provides literal string operator""sv
 using namespace std::literals::string_view_literals;
 
-const int BLOCK_SIZE = 4096;
-const int BUFFER_SIZE = 16 * 16 * BLOCK_SIZE;
+namespace {
 
-const std::bitset<128> xmlNameMask("00000111111111111111111111111110100001111111111111111111111111100000001111111111011000000000000000000000000000000000000000000000");
+    // input file of a multiple-file run, with its results
+    struct InputFile {
+        std::string path;
+        std::uintmax_t size = 0;
+        SrcFactsHandler handler;
+        long totalBytes = 0;
+        int status = 0;
+    };
 
-constexpr auto WHITESPACE = " \n\t\r"sv;
-constexpr auto NAMEEND = "> /\":=\n\t\r"sv;
+    /*
+        Output the markdown report of the measures.
 
-/*
-    Refill the content preserving the existing data.
+        @param[in] title Title of the report
+        @param[in] handler Handler with the measures
+        @param[in] files Number of source files
+        @param[in] totalBytes Number of bytes of input
+    */
+    void report(std::string_view title, const SrcFactsHandler& handler, std::uint64_t files, long totalBytes) {
 
-    @param[in, out] content View of the content
-    @return Number of bytes read
-    @retval 0 EOF
-    @retval -1 Read error
-*/
-[[nodiscard]] int refillContent(std::string_view& content) {
+        int valueWidth = std::max(5, static_cast<int>(log10(std::max(totalBytes, 1L)) * 1.3 + 1));
+        std::cout << "# srcFacts: " << title << '\n';
+        std::cout << "| Measure      | " << std::setw(valueWidth + 3) << "Value |\n";
+        std::cout << "|:-------------|-" << std::setw(valueWidth + 3) << std::setfill('-') << ":|\n" << std::setfill(' ');
+        std::cout << "| Characters   | " << std::setw(valueWidth) << handler.characters()    << " |\n";
+        std::cout << "| LOC          | " << std::setw(valueWidth) << handler.lines()         << " |\n";
+        std::cout << "| Files        | " << std::setw(valueWidth) << files                   << " |\n";
+        std::cout << "| Classes      | " << std::setw(valueWidth) << handler.count(CLASS)    << " |\n";
+        std::cout << "| Functions    | " << std::setw(valueWidth) << handler.count(FUNCTION) << " |\n";
+        std::cout << "| Declarations | " << std::setw(valueWidth) << handler.count(DECL)     << " |\n";
+        std::cout << "| Expressions  | " << std::setw(valueWidth) << handler.count(EXPR)     << " |\n";
+        std::cout << "| Comments     | " << std::setw(valueWidth) << handler.count(COMMENT)  << " |\n";
+    }
 
-    // initialize the internal buffer at first use
-    static char buffer[BUFFER_SIZE];
+    /*
+        Output the markdown table of the measures of each language.
 
-    // preserve prefix of unprocessed characters to start of the buffer
-    std::copy(content.cbegin(), content.cend(), buffer);
+        @param[in] handler Handler with the measures by language
+        @param[in] totalBytes Number of bytes of input
+    */
+    void reportLanguages(const SrcFactsHandler& handler, long totalBytes) {
 
-    // read in multiple of whole blocks
-    ssize_t bytesRead = 0;
-    while (((bytesRead = READ(0, (buffer + content.size()),
-        BUFFER_SIZE - BLOCK_SIZE)) == -1) && (errno == EINTR)) {
-    }
-    if (bytesRead == -1) {
-        // error in read
-        return -1;
+        const int valueWidth = std::max(5, static_cast<int>(log10(std::max(totalBytes, 1L)) * 1.3 + 1));
+        const auto column = [valueWidth](std::string_view name) {
+            std::cout << ' ' << std::setw(std::max(valueWidth, static_cast<int>(name.size()))) << name << " |";
+        };
+        const auto value = [valueWidth](std::string_view name, std::uint64_t measure) {
+            std::cout << ' ' << std::setw(std::max(valueWidth, static_cast<int>(name.size()))) << measure << " |";
+        };
+        const auto align = [valueWidth](std::string_view name) {
+            std::cout << '-' << std::setw(std::max(valueWidth, static_cast<int>(name.size())) + 2) << std::setfill('-') << ":|" << std::setfill(' ');
+        };
+        constexpr std::string_view columns[] = { "Files"sv, "Characters"sv, "LOC"sv, "Classes"sv, "Functions"sv,
+                                                 "Declarations"sv, "Expressions"sv, "Comments"sv };
+        std::cout << "| Language   |";
+        for (const auto name : columns)
+            column(name);
+        std::cout << "\n|:-----------|";
+        for (const auto name : columns)
+            align(name);
+        std::cout << '\n';
+        for (const auto& [language, languageMeasures] : handler.languages()) {
+            const auto& measures = languageMeasures.measures;
+            std::cout << "| " << std::left << std::setw(10) << (language.empty() ? "None"sv : std::string_view(language)) << std::right << " |";
+            const std::uint64_t values[] = { languageMeasures.files, measures.characters, measures.loc, measures.elementCounts[CLASS],
+                                             measures.elementCounts[FUNCTION], measures.elementCounts[DECL],
+                                             measures.elementCounts[EXPR], measures.elementCounts[COMMENT] };
+            for (std::size_t index = 0; index < std::size(columns); ++index)
+                value(columns[index], values[index]);
+            std::cout << '\n';
+        }
     }
 
-    // set content to the start of the buffer
-    content = std::string_view(buffer, content.size() + bytesRead);
+    /*
+        Output the hardware performance counters of the run to standard
+        error, with the counts of the parser thread waiting for input, and
+        of the rest of the run, i.e., parsing.
+    */
+    void reportPerfCounters() {
 
-    return bytesRead;
-}
+        PerfCounts run;
+        PerfCounts wait;
+        readPerfCounters(run, wait);
+        const auto counts = [](const PerfCounts& counts, int event, std::uint64_t subtract = 0) {
+            std::clog << ' ' << std::setw(16);
+            if (counts.available[event])
+                std::clog << counts.values[event] - std::min(subtract, counts.values[event]);
+            else
+                std::clog << "unavailable";
+        };
+        const auto ipc = [](std::uint64_t cycles, std::uint64_t instructions) {
+            std::clog << ' ' << std::setw(16);
+            if (cycles != 0)
+                std::clog << static_cast<double>(instructions) / static_cast<double>(cycles);
+            else
+                std::clog << "-";
+        };
+        std::clog << '\n';
+        std::clog << std::left << std::setw(14) << (perfCountersUserOnly() ? "perf (user)" : "perf") << std::right
+                  << ' ' << std::setw(16) << "run" << ' ' << std::setw(16) << "input wait" << ' ' << std::setw(16) << "parsing" << '\n';
+        for (int event = 0; event < PERF_EVENTS; ++event) {
+            std::clog << std::left << std::setw(14) << PERF_EVENT_NAMES[event] << std::right;
+            counts(run, event);
+            counts(wait, event);
+            counts(run, event, wait.values[event]);
+            std::clog << '\n';
+            if (event == INSTRUCTIONS) {
+                std::clog << std::left << std::setw(14) << "IPC" << std::right;
+                if (run.available[CYCLES] && run.available[INSTRUCTIONS]) {
+                    ipc(run.values[CYCLES], run.values[INSTRUCTIONS]);
+                    ipc(wait.values[CYCLES], wait.values[INSTRUCTIONS]);
+                    ipc(run.values[CYCLES] - std::min(wait.values[CYCLES], run.values[CYCLES]),
+                        run.values[INSTRUCTIONS] - std::min(wait.values[INSTRUCTIONS], run.values[INSTRUCTIONS]));
+                } else {
+                    for (int column = 0; column < 3; ++column)
+                        std::clog << ' ' << std::setw(16) << "unavailable";
+                }
+                std::clog << '\n';
+            }
+        }
+    }
 
-// trace parsing
-#ifdef TRACE
-#undef TRACE
-#define HEADER(m) std::clog << "\033[1m" << std::setw(10) << std::left << m << "\u001b[0m" << '\t'
-#define TRACE0() ""
-#define TRACE1(l1, n1)                         "\033[1m" << l1 << "\u001b[0m" << "|" << "\u001b[31;1m" << n1 << "\u001b[0m" << "| "
-#define TRACE2(l1, n1, l2, n2)                 TRACE1(l1,n1)             << TRACE1(l2,n2)
-#define TRACE3(l1, n1, l2, n2, l3, n3)         TRACE2(l1,n1,l2,n2)       << TRACE1(l3,n3)
-#define TRACE4(l1, n1, l2, n2, l3, n3, l4, n4) TRACE3(l1,n1,l2,n2,l3,n3) << TRACE1(l4,n4)
-#define GET_TRACE(_2,_3,_4,_5,_6,_7,_8,_9,NAME,...) NAME
-#define TRACE(m,...) HEADER(m) << GET_TRACE(__VA_ARGS__, TRACE4, _UNUSED, TRACE3, _UNUSED, TRACE2, _UNUSED, TRACE1, TRACE0, TRACE0)(__VA_ARGS__) << '\n';
-#else
-#define TRACE(...)
-#endif
+    /*
+        Parse a file of a multiple-file run, mapped into memory, or
+        streamed through decompression when compressed.
 
-int main(int argc, char* argv[]) {
+        @param[in, out] file Input file, with the results
+    */
+    void parseFile(InputFile& file) {
 
-    const auto startTime = std::chrono::steady_clock::now();
-    std::string url;
-    int textSize = 0;
-    int loc = 0;
-    int exprCount = 0;
-    int functionCount = 0;
-    int classCount = 0;
-    int unitCount = 0;
-    int declCount = 0;
-    int commentCount = 0;
-    long totalBytes = 0;
-    std::string_view content;
-    TRACE("START DOCUMENT");
-    int bytesRead = refillContent(content);
-    if (bytesRead < 0) {
-        std::cerr << "parser error : File input error\n";
-        return 1;
-    }
-    if (bytesRead == 0) {
-        std::cerr << "parser error : Empty file\n";
-        return 1;
-    }
-    totalBytes += bytesRead;
-    content.remove_prefix(content.find_first_not_of(WHITESPACE));
-    if (content[0] == '<' && content[1] == '?' && content[2] == 'x' && content[3] == 'm' && content[4] == 'l' && content[5] == ' ') {
-        // parse XML declaration
-        assert(content.compare(0, "<?xml "sv.size(), "<?xml "sv) == 0);
-        content.remove_prefix("<?xml"sv.size());
-        content.remove_prefix(content.find_first_not_of(WHITESPACE));
-        // parse required version
-        std::size_t nameEndPosition = content.find_first_of("= ");
-        const std::string_view attr(content.substr(0, nameEndPosition));
-        content.remove_prefix(nameEndPosition);
-        content.remove_prefix(content.find_first_not_of(WHITESPACE));
-        content.remove_prefix("="sv.size());
-        content.remove_prefix(content.find_first_not_of(WHITESPACE));
-        const char delimiter = content[0];
-        if (delimiter != '"' && delimiter != '\'') {
-            std::cerr << "parser error: Invalid start delimiter for version in XML declaration\n";
-            return 1;
+        const int fd = open(file.path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            std::cerr << "srcfacts : Unable to open file " << file.path << '\n';
+            file.status = 1;
+            return;
         }
-        content.remove_prefix("\""sv.size());
-        std::size_t valueEndPosition = content.find(delimiter);
-        if (valueEndPosition == content.npos) {
-            std::cerr << "parser error: Invalid end delimiter for version in XML declaration\n";
-            return 1;
+        std::string_view content;
+        const long bytesMapped = mapContent(fd, content);
+        if (bytesMapped <= 0) {
+            std::cerr << "srcfacts : Unable to map file " << file.path << '\n';
+            close(fd);
+            file.status = 1;
+            return;
         }
-        if (attr != "version"sv) {
-            std::cerr << "parser error: Missing required first attribute version in XML declaration\n";
-            return 1;
+        // a compressed file is unmapped, and streamed from a decompression thread through a reader thread
+        if (detectCompression(content) != Compression::NONE) {
+            unmapContent(content);
+            std::atomic<int> streamStatus{ 0 };
+            const int pipeFd = startFileDecompression(fd, streamStatus);
+            if (pipeFd == -1) {
+                std::cerr << "srcfacts : Unable to decompress file " << file.path << '\n';
+                file.status = 1;
+                return;
+            }
+            ContentReader* reader = startContentReader(pipeFd);
+            XMLParser<SrcFactsHandler> parser(file.handler, *reader);
+            file.status = parser.parse();
+            stopContentReader(reader);
+            file.totalBytes = parser.totalBytes();
+            if (streamStatus != 0) {
+                std::cerr << "srcfacts : Unable to decompress file " << file.path << '\n';
+                file.status = 1;
+            } else if (file.status != 0) {
+                std::cerr << "srcfacts : Parser error in file " << file.path << '\n';
+            }
+            return;
         }
-        [[maybe_unused]] const std::string_view version(content.substr(0, valueEndPosition));
-        content.remove_prefix(valueEndPosition);
-        content.remove_prefix("\""sv.size());
-        content.remove_prefix(content.find_first_not_of(WHITESPACE));
-        // parse optional encoding and standalone attributes
-        std::optional<std::string_view> encoding;
-        std::optional<std::string_view> standalone;
-        if (content[0] != '?') {
-            std::size_t nameEndPosition = content.find_first_of("= ");
-            if (nameEndPosition == content.npos) {
-                std::cerr << "parser error: Incomplete attribute in XML declaration\n";
-                return 1;
-            }
-            const std::string_view attr2(content.substr(0, nameEndPosition));
-            content.remove_prefix(nameEndPosition);
-            content.remove_prefix(content.find_first_not_of(WHITESPACE));
-            assert(content.compare(0, "="sv.size(), "="sv) == 0);
-            content.remove_prefix("="sv.size());
-            content.remove_prefix(content.find_first_not_of(WHITESPACE));
-            char delimiter2 = content[0];
-            if (delimiter2 != '"' && delimiter2 != '\'') {
-                std::cerr << "parser error: Invalid end delimiter for attribute " << attr2 << " in XML declaration\n";
-                return 1;
-            }
-            content.remove_prefix("\""sv.size());
-            std::size_t valueEndPosition = content.find(delimiter2);
-            if (valueEndPosition == content.npos) {
-                std::cerr << "parser error: Incomplete attribute " << attr2 << " in XML declaration\n";
-                return 1;
-            }
-            if (attr2 == "encoding"sv) {
-                encoding = content.substr(0, valueEndPosition);
-            } else if (attr2 == "standalone"sv) {
-                standalone = content.substr(0, valueEndPosition);
+        close(fd);
+        file.totalBytes = bytesMapped;
+        XMLParser<SrcFactsHandler> parser(file.handler, content);
+        file.status = parser.parse();
+        if (file.status != 0)
+            std::cerr << "srcfacts : Parser error in file " << file.path << '\n';
+        unmapContent(content);
+    }
+
+    /*
+        Collect the input files of the paths, with the srcML files, i.e.,
+        .xml, and compressed .xml.gz, .xml.zip, and .xml.zst, of a
+        directory and its subdirectories.
+
+        @param[in] paths Paths of files and directories
+        @param[out] inputFiles Input files in order of the paths
+        @return Status
+        @retval 0 Success
+        @retval 1 Path does not exist, with the message on standard error
+    */
+    int collectFiles(const std::vector<std::string>& paths, std::vector<InputFile>& inputFiles) {
+
+        for (const auto& path : paths) {
+            std::error_code error;
+            if (std::filesystem::is_directory(path, error)) {
+                std::vector<std::filesystem::path> directoryFiles;
+                for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+                    const auto extension = entry.path().extension();
+                    const bool compressed = extension == ".gz" || extension == ".zip" || extension == ".zst";
+                    if (entry.is_regular_file(error) && (extension == ".xml" || (compressed && entry.path().stem().extension() == ".xml")))
+                        directoryFiles.push_back(entry.path());
+                }
+                std::sort(directoryFiles.begin(), directoryFiles.end());
+                for (const auto& directoryFile : directoryFiles)
+                    inputFiles.emplace_back().path = directoryFile.string();
+            } else if (std::filesystem::exists(path, error)) {
+                inputFiles.emplace_back().path = path;
             } else {
-                std::cerr << "parser error: Invalid attribute " << attr2 << " in XML declaration\n";
+                std::cerr << "srcfacts : Unable to open file " << path << '\n';
                 return 1;
             }
-            content.remove_prefix(valueEndPosition + 1);
-            content.remove_prefix(content.find_first_not_of(WHITESPACE));
         }
-        if (content[0] != '?') {
-            std::size_t nameEndPosition = content.find_first_of("= ");
-            if (nameEndPosition == content.npos) {
-                std::cerr << "parser error: Incomplete attribute in XML declaration\n";
-                return 1;
-            }
-            const std::string_view attr2(content.substr(0, nameEndPosition));
-            content.remove_prefix(nameEndPosition);
-            content.remove_prefix(content.find_first_not_of(WHITESPACE));
-            content.remove_prefix("="sv.size());
-            content.remove_prefix(content.find_first_not_of(WHITESPACE));
-            const char delimiter2 = content[0];
-            if (delimiter2 != '"' && delimiter2 != '\'') {
-                std::cerr << "parser error: Invalid end delimiter for attribute " << attr2 << " in XML declaration\n";
-                return 1;
-            }
-            content.remove_prefix("\""sv.size());
-            std::size_t valueEndPosition = content.find(delimiter2);
-            if (valueEndPosition == content.npos) {
-                std::cerr << "parser error: Incomplete attribute " << attr2 << " in XML declaration\n";
-                return 1;
-            }
-            if (!standalone && attr2 == "standalone"sv) {
-                standalone = content.substr(0, valueEndPosition);
-            } else {
-                std::cerr << "parser error: Invalid attribute " << attr2 << " in XML declaration\n";
-                return 1;
-            }
-            // assert(content[valueEndPosition + 1] == '"');
-            content.remove_prefix(valueEndPosition + 1);
-            content.remove_prefix(content.find_first_not_of(WHITESPACE));
+        for (auto& inputFile : inputFiles) {
+            std::error_code error;
+            inputFile.size = std::filesystem::file_size(inputFile.path, error);
         }
-        TRACE("XML DECLARATION", "version", version, "encoding", (encoding ? *encoding : ""), "standalone", (standalone ? *standalone : ""));
-        assert(content.compare(0, "?>"sv.size(), "?>"sv) == 0);
-        content.remove_prefix("?>"sv.size());
-        content.remove_prefix(content.find_first_not_of(WHITESPACE));
+
+        return 0;
     }
-    if (content[1] == '!' && content[0] == '<' && content[2] == 'D' && content[3] == 'O' && content[4] == 'C' && content[5] == 'T' && content[6] == 'Y' && content[7] == 'P' && content[8] == 'E' && content[9] == ' ') {
-        // parse DOCTYPE
-        assert(content.compare(0, "<!DOCTYPE "sv.size(), "<!DOCTYPE "sv) == 0);
-        content.remove_prefix("<!DOCTYPE"sv.size());
-        int depthAngleBrackets = 1;
-        bool inSingleQuote = false;
-        bool inDoubleQuote = false;
-        bool inComment = false;
-        std::size_t p = 0;
-        while ((p = content.find_first_of("<>'\"-"sv, p)) != content.npos) {
-            if (content.compare(p, "<!--"sv.size(), "<!--"sv) == 0) {
-                inComment = true;
-                p += "<!--"sv.size();
-                continue;
-            } else if (content.compare(p, "-->"sv.size(), "-->"sv) == 0) {
-                inComment = false;
-                p += "-->"sv.size();
-                continue;
-            }
-            if (inComment) {
-                ++p;
-                continue;
-            }
-            if (content[p] == '<' && !inSingleQuote && !inDoubleQuote) {
-                ++depthAngleBrackets;
-            } else if (content[p] == '>' && !inSingleQuote && !inDoubleQuote) {
-                --depthAngleBrackets;
-            } else if (content[p] == '\'') {
-                inSingleQuote = !inSingleQuote;
-            } else if (content[p] == '"') {
-                inDoubleQuote = !inDoubleQuote;
-            }
-            if (depthAngleBrackets == 0)
-                break;
-            ++p;
+}
+
+int main(int argc, char* argv[]) {
+
+    const auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::string> paths;
+    std::string_view engine = "mmap"sv;
+    int jobs = 0;
+    bool jobsOption = false;
+    bool speculative = false;
+    bool ndjson = false;
+    std::string cachePath;
+    std::vector<std::string_view> excludePatterns;
+    std::vector<std::string_view> languages;
+    bool byLanguage = false;
+    bool perfStats = false;
+    std::string tracePath;
+    for (int arg = 1; arg < argc; ++arg) {
+        const std::string_view option(argv[arg]);
+        if (option.compare(0, "--engine="sv.size(), "--engine="sv) == 0) {
+            engine = option.substr("--engine="sv.size());
+        } else if (option.compare(0, "--jobs="sv.size(), "--jobs="sv) == 0) {
+            jobs = std::atoi(argv[arg] + "--jobs="sv.size());
+            jobsOption = true;
+        } else if (option == "--speculative"sv) {
+            speculative = true;
+        } else if (option == "--ndjson"sv) {
+            ndjson = true;
+        } else if (option.compare(0, "--cache="sv.size(), "--cache="sv) == 0) {
+            cachePath = option.substr("--cache="sv.size());
+        } else if (option.compare(0, "--exclude="sv.size(), "--exclude="sv) == 0) {
+            excludePatterns.push_back(option.substr("--exclude="sv.size()));
+        } else if (option.compare(0, "--language="sv.size(), "--language="sv) == 0) {
+            languages.push_back(option.substr("--language="sv.size()));
+        } else if (option == "--by-language"sv) {
+            byLanguage = true;
+        } else if (option == "--perf-stats"sv) {
+            perfStats = true;
+        } else if (option.compare(0, "--trace="sv.size(), "--trace="sv) == 0) {
+            tracePath = option.substr("--trace="sv.size());
+        } else if (!option.empty() && option[0] != '-') {
+            paths.emplace_back(option);
+        } else {
+            engine = ""sv;
+            break;
         }
-        [[maybe_unused]] const std::string_view contents(content.substr(0, p));
-        TRACE("DOCTYPE", "contents", contents);
-        content.remove_prefix(p);
-        assert(content[0] == '>');
-        content.remove_prefix(">"sv.size());
-        content.remove_prefix(content.find_first_not_of(WHITESPACE));
     }
-    int depth = 0;
-    bool doneReading = false;
-    while (true) {
-        if (doneReading) {
-            if (content.empty())
-                break;
-        } else if (content.size() < BLOCK_SIZE) {
-            // refill content preserving unprocessed
-            int bytesRead = refillContent(content);
-            if (bytesRead < 0) {
-                std::cerr << "parser error : File input error\n";
-                return 1;
-            }
-            if (bytesRead == 0) {
-                doneReading = true;
-            }
-            totalBytes += bytesRead;
-        }
-        if (content[0] == '&') {
-            // parse character entity references
-            std::string_view unescapedCharacter;
-            std::string_view escapedCharacter;
-            if (content[1] == 'l' && content[2] == 't' && content[3] == ';') {
-                unescapedCharacter = "<";
-                escapedCharacter = "&lt;"sv;
-            } else if (content[1] == 'g' && content[2] == 't' && content[3] == ';') {
-                unescapedCharacter = ">";
-                escapedCharacter = "&gt;"sv;
-            } else if (content[1] == 'a' && content[2] == 'm' && content[3] == 'p' && content[4] == ';') {
-                unescapedCharacter = "&";
-                escapedCharacter = "&amp;"sv;
-            } else {
-                unescapedCharacter = "&";
-                escapedCharacter = "&"sv;
-            }
-            assert(content.compare(0, escapedCharacter.size(), escapedCharacter) == 0);
-            content.remove_prefix(escapedCharacter.size());
-            [[maybe_unused]] const std::string_view characters(unescapedCharacter);
-            TRACE("CHARACTERS", "characters", characters);
-            ++textSize;
-        } else if (content[0] != '<') {
-            // parse character non-entity references
-            assert(content[0] != '<' && content[0] != '&');
-            std::size_t characterEndPosition = content.find_first_of("<&");
-            const std::string_view characters(content.substr(0, characterEndPosition));
-            TRACE("CHARACTERS", "characters", characters);
-            loc += static_cast<int>(std::count(characters.cbegin(), characters.cend(), '\n'));
-            textSize += static_cast<int>(characters.size());
-            content.remove_prefix(characters.size());
-        } else if (content[1] == '!' /* && content[0] == '<' */ && content[2] == '-' && content[3] == '-') {
-            // parse XML comment
-            assert(content.compare(0, "<!--"sv.size(), "<!--"sv) == 0);
-            content.remove_prefix("<!--"sv.size());
-            std::size_t tagEndPosition = content.find("-->"sv);
-            if (tagEndPosition == content.npos) {
-                // refill content preserving unprocessed
-                int bytesRead = refillContent(content);
-                if (bytesRead < 0) {
-                    std::cerr << "parser error : File input error\n";
-                    return 1;
-                }
-                if (bytesRead == 0) {
-                    doneReading = true;
-                }
-                totalBytes += bytesRead;
-                tagEndPosition = content.find("-->"sv);
-                if (tagEndPosition == content.npos) {
-                    std::cerr << "parser error : Unterminated XML comment\n";
-                    return 1;
-                }
+    if (engine != "mmap"sv && engine != "thread"sv && engine != "uring"sv && engine != "ring"sv) {
+        std::cerr << "usage: srcfacts [--engine=mmap|thread|uring|ring] [--jobs=N] [--speculative] [--ndjson] [--cache=file] [--exclude=pattern]... [--language=name]... [--by-language] [--perf-stats] [--trace=file] [file|directory]...\n";
+        return 1;
+    }
+    // counters are inherited only by threads created after they are opened
+    if (perfStats && startPerfCounters() == 0)
+        std::clog << "srcfacts : perf counters unavailable, check perf_event_paranoid\n";
+    // a single file is parsed by one thread unless --jobs is given, otherwise one thread per core
+    const bool multipleFiles = paths.size() > 1 || (paths.size() == 1 && std::filesystem::is_directory(paths[0]));
+    if (jobs < 1)
+        jobs = (jobsOption || multipleFiles) ? std::max(static_cast<int>(std::thread::hardware_concurrency()), 1) : 1;
+    if (multipleFiles && !tracePath.empty()) {
+        std::cerr << "srcfacts : --trace requires a single input\n";
+        return 1;
+    }
+    UnitCache cache;
+    if (!cachePath.empty() && cache.load(cachePath) != 0)
+        return 1;
+    std::cout.imbue(std::locale{""});
+    std::clog.imbue(std::locale{""});
+    std::clog.precision(3);
+    if (multipleFiles) {
+        // files are mapped and parsed whole, or streamed when compressed, largest first on the thread pool
+        std::vector<InputFile> inputFiles;
+        if (collectFiles(paths, inputFiles) != 0)
+            return 1;
+        std::vector<std::size_t> largestFirst(inputFiles.size());
+        for (std::size_t index = 0; index < largestFirst.size(); ++index)
+            largestFirst[index] = index;
+        std::stable_sort(largestFirst.begin(), largestFirst.end(), [&inputFiles](std::size_t first, std::size_t second) {
+            return inputFiles[first].size > inputFiles[second].size;
+        });
+        runWorkStealing(largestFirst.size(), jobs, [&](std::size_t task) {
+            InputFile& inputFile = inputFiles[largestFirst[task]];
+            if (ndjson)
+                inputFile.handler.reportUnits(std::cout);
+            if (!cachePath.empty())
+                inputFile.handler.useCache(cache);
+            for (const auto pattern : excludePatterns)
+                inputFile.handler.exclude(pattern);
+            for (const auto language : languages)
+                inputFile.handler.selectLanguage(language);
+            if (byLanguage)
+                inputFile.handler.countLanguages();
+            parseFile(inputFile);
+        });
+
+        // report each file in the order of the paths, then all of them
+        SrcFactsHandler total;
+        std::uint64_t totalFiles = 0;
+        long totalBytes = 0;
+        int status = 0;
+        for (const auto& inputFile : inputFiles) {
+            if (inputFile.status != 0) {
+                status = 1;
+                continue;
             }
-            [[maybe_unused]] const std::string_view comment(content.substr(0, tagEndPosition));
-            TRACE("COMMENT", "content", comment);
-            content.remove_prefix(tagEndPosition);
-            content.remove_prefix("-->"sv.size());
-        } else if (content[1] == '!' /* && content[0] == '<' */ && content[2] == '[' && content[3] == 'C' && content[4] == 'D' &&
-                   content[5] == 'A' && content[6] == 'T' && content[7] == 'A' && content[8] == '[') {
-            // parse CDATA
-            content.remove_prefix("<![CDATA["sv.size());
-            std::size_t tagEndPosition = content.find("]]>"sv);
-            if (tagEndPosition == content.npos) {
-                // refill content preserving unprocessed
-                int bytesRead = refillContent(content);
-                if (bytesRead < 0) {
-                    std::cerr << "parser error : File input error\n";
-                    return 1;
+            if (!ndjson) {
+                report(inputFile.path, inputFile.handler, inputFile.handler.files(), inputFile.totalBytes);
+                std::cout << '\n';
+                if (byLanguage) {
+                    reportLanguages(inputFile.handler, inputFile.totalBytes);
+                    std::cout << '\n';
                 }
-                if (bytesRead == 0) {
-                    doneReading = true;
-                }
-                totalBytes += bytesRead;
-                tagEndPosition = content.find("]]>"sv);
-                if (tagEndPosition == content.npos) {
-                    std::cerr << "parser error : Unterminated CDATA\n";
-                    return 1;
-                }
-            }
-            const std::string_view characters(content.substr(0, tagEndPosition));
-            TRACE("CDATA", "characters", characters);
-            textSize += static_cast<int>(characters.size());
-            loc += static_cast<int>(std::count(characters.cbegin(), characters.cend(), '\n'));
-            content.remove_prefix(tagEndPosition);
-            content.remove_prefix("]]>"sv.size());
-        } else if (content[1] == '?' /* && content[0] == '<' */) {
-            // parse processing instruction
-            assert(content.compare(0, "<?"sv.size(), "<?"sv) == 0);
-            content.remove_prefix("<?"sv.size());
-            std::size_t tagEndPosition = content.find("?>"sv);
-            if (tagEndPosition == content.npos) {
-                std::cerr << "parser error: Incomplete XML declaration\n";
-                return 1;
             }
-            std::size_t nameEndPosition = content.find_first_of(NAMEEND);
-            if (nameEndPosition == content.npos) {
-                std::cerr << "parser error : Unterminated processing instruction\n";
-                return 1;
-            }
-            [[maybe_unused]] const std::string_view target(content.substr(0, nameEndPosition));
-            [[maybe_unused]] const std::string_view data(content.substr(nameEndPosition, tagEndPosition - nameEndPosition));
-            TRACE("PI", "target", target, "data", data);
-            content.remove_prefix(tagEndPosition);
-            assert(content.compare(0, "?>"sv.size(), "?>"sv) == 0);
-            content.remove_prefix("?>"sv.size());
-        } else if (content[1] == '/' /* && content[0] == '<' */) {
-            // parse end tag
-            assert(content.compare(0, "</"sv.size(), "</"sv) == 0);
-            content.remove_prefix("</"sv.size());
-            if (content[0] == ':') {
-                std::cerr << "parser error : Invalid end tag name\n";
-                return 1;
-            }
-            std::size_t nameEndPosition = content.find_first_of(NAMEEND);
-            if (nameEndPosition == content.size()) {
-                std::cerr << "parser error : Unterminated end tag '" << content.substr(0, nameEndPosition) << "'\n";
-                return 1;
-            }
-            size_t colonPosition = 0;
-            if (content[nameEndPosition] == ':') {
-                colonPosition = nameEndPosition;
-                nameEndPosition = content.find_first_of(NAMEEND, nameEndPosition + 1);
-            }
-            const std::string_view qName(content.substr(0, nameEndPosition));
-            if (qName.empty()) {
-                std::cerr << "parser error: EndTag: invalid element name\n";
-                return 1;
-            }
-            [[maybe_unused]] const std::string_view prefix(qName.substr(0, colonPosition));
-            [[maybe_unused]] const std::string_view localName(qName.substr(colonPosition ? colonPosition + 1 : 0));
-            TRACE("END TAG", "qName", qName, "prefix", prefix, "localName", localName);
-            content.remove_prefix(nameEndPosition);
-            content.remove_prefix(content.find_first_not_of(WHITESPACE));
-            assert(content.compare(0, ">"sv.size(), ">"sv) == 0);
-            content.remove_prefix(">"sv.size());
-            --depth;
-            if (depth == 0)
-                break;
-        } else if (content[0] == '<') {
-            // parse start tag
-            assert(content.compare(0, "<"sv.size(), "<"sv) == 0);
-            content.remove_prefix("<"sv.size());
-            if (content[0] == ':') {
-                std::cerr << "parser error : Invalid start tag name\n";
-                return 1;
-            }
-            std::size_t nameEndPosition = content.find_first_of(NAMEEND);
-            if (nameEndPosition == content.size()) {
-                std::cerr << "parser error : Unterminated start tag '" << content.substr(0, nameEndPosition) << "'\n";
-                return 1;
-            }
-            size_t colonPosition = 0;
-            if (content[nameEndPosition] == ':') {
-                colonPosition = nameEndPosition;
-                nameEndPosition = content.find_first_of(NAMEEND, nameEndPosition + 1);
-            }
-            const std::string_view qName(content.substr(0, nameEndPosition));
-            if (qName.empty()) {
-                std::cerr << "parser error: StartTag: invalid element name\n";
-                return 1;
-            }
-            [[maybe_unused]] const std::string_view prefix(qName.substr(0, colonPosition));
-            const std::string_view localName(qName.substr(colonPosition ? colonPosition + 1 : 0, nameEndPosition));
-            TRACE("START TAG", "qName", qName, "prefix", prefix, "localName", localName);
-            bool inEscape = localName == "escape"sv;
-            if (localName == "expr"sv) {
-                ++exprCount;
-            } else if (localName == "decl"sv) {
-                ++declCount;
-            } else if (localName == "comment"sv) {
-                ++commentCount;
-            } else if (localName == "function"sv) {
-                ++functionCount;
-            } else if (localName == "unit"sv) {
-                ++unitCount;
-            } else if (localName == "class"sv) {
-                ++classCount;
-            }
-            content.remove_prefix(nameEndPosition);
-            content.remove_prefix(content.find_first_not_of(WHITESPACE));
-            while (xmlNameMask[content[0]]) {
-                if (content[0] == 'x' && content[1] == 'm' && content[2] == 'l' && content[3] == 'n' && content[4] == 's' && (content[5] == ':' || content[5] == '=')) {
-                    // parse XML namespace
-                    assert(content.compare(0, "xmlns"sv.size(), "xmlns"sv) == 0);
-                    content.remove_prefix("xmlns"sv.size());
-                    std::size_t nameEndPosition = content.find('=');
-                    if (nameEndPosition == content.npos) {
-                        std::cerr << "parser error : incomplete namespace\n";
-                        return 1;
-                    }
-                    std::size_t prefixSize = 0;
-                    if (content[0] == ':') {
-                        content.remove_prefix(":"sv.size());
-                        --nameEndPosition;
-                        prefixSize = nameEndPosition;
-                    }
-                    [[maybe_unused]] const std::string_view prefix(content.substr(0, prefixSize));
-                    content.remove_prefix(nameEndPosition);
-                    content.remove_prefix("="sv.size());
-                    content.remove_prefix(content.find_first_not_of(WHITESPACE));
-                    if (content.empty()) {
-                        std::cerr << "parser error : incomplete namespace\n";
-                        return 1;
-                    }
-                    const char delimiter = content[0];
-                    if (delimiter != '"' && delimiter != '\'') {
-                        std::cerr << "parser error : incomplete namespace\n";
-                        return 1;
-                    }
-                    content.remove_prefix("\""sv.size());
-                    std::size_t valueEndPosition = content.find(delimiter);
-                    if (valueEndPosition == content.npos) {
-                        std::cerr << "parser error : incomplete namespace\n";
-                        return 1;
-                    }
-                    [[maybe_unused]] const std::string_view uri(content.substr(0, valueEndPosition));
-                    TRACE("NAMESPACE", "prefix", prefix, "uri", uri);
-                    content.remove_prefix(valueEndPosition);
-                    assert(content.compare(0, "\""sv.size(), "\""sv) == 0);
-                    content.remove_prefix("\""sv.size());
-                    content.remove_prefix(content.find_first_not_of(WHITESPACE));
-                } else {
-                    // parse attribute
-                    std::size_t nameEndPosition = content.find_first_of(NAMEEND);
-                    if (nameEndPosition == content.size()) {
-                        std::cerr << "parser error : Empty attribute name" << '\n';
-                        return 1;
-                    }
-                    size_t colonPosition = 0;
-                    if (content[nameEndPosition] == ':') {
-                        colonPosition = nameEndPosition;
-                        nameEndPosition = content.find_first_of(NAMEEND, nameEndPosition + 1);
-                    }
-                    const std::string_view qName(content.substr(0, nameEndPosition));
-                    [[maybe_unused]] const std::string_view prefix(qName.substr(0, colonPosition));
-                    const std::string_view localName(qName.substr(colonPosition ? colonPosition + 1 : 0));
-                    content.remove_prefix(nameEndPosition);
-                    content.remove_prefix(content.find_first_not_of(WHITESPACE));
-                    if (content.empty()) {
-                        std::cerr << "parser error : attribute " << qName << " incomplete attribute\n";
-                        return 1;
-                    }
-                    if (content[0] != '=') {
-                        std::cerr << "parser error : attribute " << qName << " missing =\n";
-                        return 1;
-                    }
-                    content.remove_prefix("="sv.size());
-                    content.remove_prefix(content.find_first_not_of(WHITESPACE));
-                    const char delimiter = content[0];
-                    if (delimiter != '"' && delimiter != '\'') {
-                        std::cerr << "parser error : attribute " << qName << " missing delimiter\n";
-                        return 1;
-                    }
-                    content.remove_prefix("\""sv.size());
-                    std::size_t valueEndPosition = content.find(delimiter);
-                    if (valueEndPosition == content.npos) {
-                        std::cerr << "parser error : attribute " << qName << " missing delimiter\n";
-                        return 1;
-                    }
-                    const std::string_view value(content.substr(0, valueEndPosition));
-                    if (localName == "url"sv)
-                        url = value;
-                    TRACE("ATTRIBUTE", "qname", qName, "prefix", prefix, "localName", localName, "value", value);
-                    // convert special srcML escaped element to characters
-                    if (inEscape && localName == "char"sv /* && inUnit */) {
-                        // use strtol() instead of atoi() since strtol() understands hex encoding of '0x0?'
-                        [[maybe_unused]] char escapeValue = (char)strtol(value.data(), NULL, 0);
-                    }
-                    content.remove_prefix(valueEndPosition);
-                    content.remove_prefix("\""sv.size());
-                    content.remove_prefix(content.find_first_not_of(WHITESPACE));
-                }
-            }
-            if (content[0] == '>') {
-                content.remove_prefix(">"sv.size());
-                ++depth;
-            } else if (content[0] == '/' && content[1] == '>') {
-                assert(content.compare(0, "/>"sv.size(), "/>") == 0);
-                content.remove_prefix("/>"sv.size());
-                TRACE("END TAG", "qName", qName, "prefix", prefix, "localName", localName);
-                if (depth == 0)
-                    break;
+            total.merge(inputFile.handler);
+            totalFiles += inputFile.handler.files();
+            totalBytes += inputFile.totalBytes;
+        }
+        if (!ndjson) {
+            report("Total", total, totalFiles, totalBytes);
+            if (byLanguage) {
+                std::cout << '\n';
+                reportLanguages(total, totalBytes);
             }
-        } else {
-            std::cerr << "parser error : invalid XML document\n";
-            return 1;
         }
+        if (!cachePath.empty() && cache.save(cachePath) != 0)
+            status = 1;
+        const auto finishTime = std::chrono::steady_clock::now();
+        const auto elapsedSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(finishTime - startTime).count();
+        std::clog << '\n';
+        std::clog << inputFiles.size() << " input files\n";
+        std::clog << totalBytes  << " bytes\n";
+        std::clog << elapsedSeconds << " sec\n";
+        std::clog << total.lines() / elapsedSeconds / 1000000 << " MLOC/sec\n";
+        if (perfStats)
+            reportPerfCounters();
+#ifdef TOKEN_STATS
+        reportTokenStats(std::clog);
+#endif
+        return status;
     }
-    content.remove_prefix(content.find_first_not_of(WHITESPACE) == content.npos ? content.size() : content.find_first_not_of(WHITESPACE));
-    while (!content.empty() && content[0] == '<' && content[1] == '!' && content[2] == '-' && content[3] == '-') {
-        // parse XML comment
-        assert(content.compare(0, "<!--"sv.size(), "<!--"sv) == 0);
-        content.remove_prefix("<!--"sv.size());
-        std::size_t tagEndPosition = content.find("-->"sv);
-        if (tagEndPosition == content.npos) {
-            // refill content preserving unprocessed
-            int bytesRead = refillContent(content);
-            if (bytesRead < 0) {
-                std::cerr << "parser error : File input error\n";
-                return 1;
-            }
-            if (bytesRead == 0) {
-                doneReading = true;
-            }
-            totalBytes += bytesRead;
-            tagEndPosition = content.find("-->"sv);
-            if (tagEndPosition == content.npos) {
-                std::cerr << "parser error : Unterminated XML comment\n";
-                return 1;
-            }
+    if (!paths.empty()) {
+        // input file replaces standard input
+        const int fd = open(paths[0].c_str(), O_RDONLY);
+        if (fd == -1) {
+            std::cerr << "srcfacts : Unable to open file " << paths[0] << '\n';
+            return 1;
         }
-        [[maybe_unused]] const std::string_view comment(content.substr(0, tagEndPosition));
-        TRACE("COMMENT", "content", comment);
-        content.remove_prefix(tagEndPosition);
-        assert(content.compare(0, "-->"sv.size(), "-->"sv) == 0);
-        content.remove_prefix("-->"sv.size());
-        content.remove_prefix(content.find_first_not_of(WHITESPACE) == content.npos ? content.size() : content.find_first_not_of(WHITESPACE));
+        dup2(fd, 0);
+        close(fd);
     }
-    if (!content.empty()) {
-        std::cerr << "parser error : extra content at end of document\n";
+    if (startDecompression(0) != 0)
         return 1;
+    if (engine == "uring"sv && selectInputEngine(InputEngine::URING) != InputEngine::URING) {
+        std::clog << "srcfacts : io_uring unavailable for this input, using read()\n";
+    }
+    if (engine == "ring"sv && selectInputEngine(InputEngine::RING) != InputEngine::RING) {
+        std::clog << "srcfacts : ring buffer unavailable, using double buffers\n";
+    }
+    // map regular files directly, otherwise stream the input
+    std::string_view content;
+    const long bytesMapped = engine == "mmap"sv ? mapContent(0, content) : 0;
+    if (bytesMapped < 0) {
+        std::cerr << "parser error : File input error\n";
+        return 1;
+    }
+    // units are tracked in document order by a single parser
+    SrcFactsHandler handler;
+    bool unitsTracked = false;
+    if (ndjson) {
+        handler.reportUnits(std::cout);
+        unitsTracked = true;
+    }
+    if (!cachePath.empty()) {
+        handler.useCache(cache);
+        unitsTracked = true;
+    }
+    for (const auto pattern : excludePatterns) {
+        handler.exclude(pattern);
+        unitsTracked = true;
     }
-    TRACE("END DOCUMENT");
+    for (const auto language : languages) {
+        handler.selectLanguage(language);
+        unitsTracked = true;
+    }
+    if (byLanguage) {
+        handler.countLanguages();
+        unitsTracked = true;
+    }
+    if (unitsTracked) {
+        if (jobs > 1)
+            std::clog << "srcfacts : --jobs ignored, since --ndjson, --cache, --exclude, --language, and --by-language parse a single file with one thread\n";
+        jobs = 1;
+    }
+    // failed speculative chunks are parsed again, which would trace their events twice
+    if (!tracePath.empty()) {
+        if (startTracing(tracePath) != 0)
+            return 1;
+        if (speculative && jobs > 1) {
+            std::clog << "srcfacts : --jobs ignored, since --speculative with --trace parses with one thread\n";
+            jobs = 1;
+        }
+    }
+    long totalBytes = 0;
+    if (bytesMapped > 0) {
+        // only mapped input is available as a whole for parallel parsing
+        const int status = speculative ? parseSpeculative(content, jobs, handler) : parseParallel(content, jobs, handler);
+        if (status != 0)
+            return 1;
+        totalBytes = bytesMapped;
+    } else {
+        XMLParser<SrcFactsHandler> parser(handler, content);
+        if (parser.parse() != 0 || decompressionStatus() != 0)
+            return 1;
+        totalBytes = parser.totalBytes();
+    }
+    if (stopTracing() != 0)
+        return 1;
+    const std::uint64_t loc = handler.lines();
     const auto finishTime = std::chrono::steady_clock::now();
     const auto elapsedSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(finishTime - startTime).count();
     const double MLOCPerSecond = loc / elapsedSeconds / 1000000;
-    int files = std::max(unitCount - 1, 1);
-    std::cout.imbue(std::locale{""});
-    int valueWidth = std::max(5, static_cast<int>(log10(totalBytes) * 1.3 + 1));
-    std::cout << "# srcFacts: " << url << '\n';
-    std::cout << "| Measure      | " << std::setw(valueWidth + 3) << "Value |\n";
-    std::cout << "|:-------------|-" << std::setw(valueWidth + 3) << std::setfill('-') << ":|\n" << std::setfill(' ');
-    std::cout << "| Characters   | " << std::setw(valueWidth) << textSize      << " |\n";
-    std::cout << "| LOC          | " << std::setw(valueWidth) << loc           << " |\n";
-    std::cout << "| Files        | " << std::setw(valueWidth) << files         << " |\n";
-    std::cout << "| Classes      | " << std::setw(valueWidth) << classCount    << " |\n";
-    std::cout << "| Functions    | " << std::setw(valueWidth) << functionCount << " |\n";
-    std::cout << "| Declarations | " << std::setw(valueWidth) << declCount     << " |\n";
-    std::cout << "| Expressions  | " << std::setw(valueWidth) << exprCount     << " |\n";
-    std::cout << "| Comments     | " << std::setw(valueWidth) << commentCount  << " |\n";
-    std::clog.imbue(std::locale{""});
-    std::clog.precision(3);
+    if (!ndjson) {
+        report(handler.url(), handler, handler.files(), totalBytes);
+        if (byLanguage) {
+            std::cout << '\n';
+            reportLanguages(handler, totalBytes);
+        }
+    }
+    if (!cachePath.empty() && cache.save(cachePath) != 0)
+        return 1;
     std::clog << '\n';
     std::clog << totalBytes  << " bytes\n";
     std::clog << elapsedSeconds << " sec\n";
     std::clog << MLOCPerSecond << " MLOC/sec\n";
+    std::clog << refillWaitSeconds() << " sec waiting for input\n";
+    if (perfStats)
+        reportPerfCounters();
+#ifdef TOKEN_STATS
+    reportTokenStats(std::clog);
+#endif
     return 0;
 }
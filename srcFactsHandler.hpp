@@ -0,0 +1,405 @@
+/*
+    srcFactsHandler.hpp
+
+    XMLParser handler that collects the srcFacts measures of srcML.
+
+    Optionally, the measures of each unit, i.e., each source file, are
+    output as a line of JSON when the unit ends. For an archive these are
+    the units inside of the root unit, otherwise the root unit itself.
+    With a UnitCache, a unit with a cached hash attribute is skipped and
+    its cached measures are used, and the measures of other units are
+    added to the cache. A unit with a filename that matches an exclude
+    pattern, or in a language that is not selected, is skipped, and not
+    counted. While filtering, the measures are the sum of the selected
+    units, without the text of an archive between them. The measures of
+    units can also be summed by language.
+*/
+
+#ifndef INCLUDED_SRCFACTSHANDLER_HPP
+#define INCLUDED_SRCFACTSHANDLER_HPP
+
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <mutex>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cctype>
+#include <stdlib.h>
+#include "xmlParserHandler.hpp"
+#include "countedElements.hpp"
+#include "factCounters.hpp"
+#include "scanContent.hpp"
+#include "unitCache.hpp"
+
+// measures of the units of a language
+struct LanguageMeasures {
+    std::uint64_t files = 0;
+    FactCounters measures;
+};
+
+class SrcFactsHandler : public XMLParserHandler {
+public:
+
+    void onStartTag(std::string_view /* prefix */, std::string_view /* qName */, std::string_view localName) {
+
+        using namespace std::literals::string_view_literals;
+        inEscape = localName == "escape"sv;
+        const int element = countedElement(localName);
+        if (element != -1)
+            ++counts.elementCounts[element];
+        inUnitTag = element == UNIT && trackUnits;
+        if (inUnitTag)
+            startUnit();
+    }
+
+    void onEndTag(std::string_view /* prefix */, std::string_view /* qName */, std::string_view localName) {
+
+        using namespace std::literals::string_view_literals;
+        if (trackUnits && localName == "unit"sv)
+            endUnit();
+    }
+
+    bool skipContent() {
+
+        if (!inUnitTag || unitDepth > 2)
+            return false;
+        if (!unitSelected()) {
+            unitExcluded = true;
+            return true;
+        }
+        if (!unitCache || unitHash.empty())
+            return false;
+        FactCounters measures;
+        if (!unitCache->find(unitHash, measures))
+            return false;
+        counts.merge(measures);
+        unitCached = true;
+
+        return true;
+    }
+
+    void onAttribute(std::string_view /* prefix */, std::string_view /* qName */, std::string_view localName,
+                     std::string_view value) {
+
+        using namespace std::literals::string_view_literals;
+        if (localName == "url"sv)
+            urlValue = value;
+        if (inUnitTag && unitDepth <= 2) {
+            if (localName == "filename"sv)
+                unitFilename = value;
+            else if (localName == "language"sv)
+                unitLanguage = value;
+            else if (localName == "hash"sv)
+                unitHash = value;
+        }
+        // convert special srcML escaped element to characters
+        if (inEscape && localName == "char"sv /* && inUnit */) {
+            // use strtol() instead of atoi() since strtol() understands hex encoding of '0x0?'
+            [[maybe_unused]] char escapeValue = (char)strtol(value.data(), NULL, 0);
+        }
+    }
+
+    void onCharacters(std::string_view characters, int newlines) {
+
+        counts.characters += characters.size();
+        counts.loc += static_cast<std::uint64_t>(newlines);
+    }
+
+    void onCDATA(std::string_view characters) {
+
+        counts.characters += characters.size();
+        counts.loc += static_cast<std::uint64_t>(countNewlines(characters));
+    }
+
+    /*
+        Merge the measures of a handler of a later part of the same input
+
+        @param[in] other Handler of the later part
+    */
+    void merge(const SrcFactsHandler& other) {
+
+        if (!other.urlValue.empty())
+            urlValue = other.urlValue;
+        counts.merge(other.measures());
+        for (const auto& [language, otherMeasures] : other.languageMeasures)
+            addLanguage(language, otherMeasures.files, otherMeasures.measures);
+    }
+
+    /*
+        Output the measures of each unit as newline-delimited JSON
+
+        @param[in] output Stream of the records, each written whole and flushed
+    */
+    void reportUnits(std::ostream& output) { unitOutput = &output; trackUnits = true; }
+
+    /*
+        Use and add to a cache of the measures of units
+
+        @param[in, out] cache Cache of the measures of units by hash
+    */
+    void useCache(UnitCache& cache) { unitCache = &cache; trackUnits = true; }
+
+    /*
+        Exclude units with a filename that matches a pattern
+
+        @param[in] pattern Glob pattern, where '*' matches any characters, including '/', and '?' any one character
+    */
+    void exclude(std::string_view pattern) { excludePatterns.emplace_back(pattern); trackUnits = true; }
+
+    /*
+        Select a language, so that units in other languages are skipped
+
+        @param[in] language Language attribute of the units, compared ignoring case
+    */
+    void selectLanguage(std::string_view language) { selectedLanguages.emplace_back(language); trackUnits = true; }
+
+    // sum the measures of units by language
+    void countLanguages() { byLanguage = true; trackUnits = true; }
+
+    // measures by language, when counted
+    const std::map<std::string, LanguageMeasures>& languages() const { return languageMeasures; }
+
+    // last url attribute
+    const std::string& url() const { return urlValue; }
+
+    // number of characters of text
+    std::uint64_t characters() const { return measures().characters; }
+
+    // lines of code
+    std::uint64_t lines() const { return measures().loc; }
+
+    // number of a counted element
+    std::uint64_t count(CountedElement element) const { return measures().elementCounts[element]; }
+
+    /*
+        Number of source files, i.e., the units inside of an archive, or
+        the root unit that is not an archive. When units are tracked, only
+        the units that are selected are counted.
+
+        @return Number of source files
+    */
+    std::uint64_t files() const {
+
+        if (trackUnits)
+            return selectedFiles;
+        const std::uint64_t units = counts.elementCounts[UNIT];
+        return units > 1 ? units - 1 : units;
+    }
+
+private:
+
+    // measures of the input, or only of the selected units when filtering
+    const FactCounters& measures() const { return filtering() ? selectedCounts : counts; }
+
+    // units are filtered by filename or language
+    bool filtering() const { return !excludePatterns.empty() || !selectedLanguages.empty(); }
+
+    // start of a unit, with the measures at its start
+    void startUnit() {
+
+        ++unitDepth;
+        if (unitDepth > 2)
+            return;
+        if (unitDepth == 2)
+            nestedUnits = true;
+        unitFilename.clear();
+        unitLanguage.clear();
+        unitHash.clear();
+        unitCached = false;
+        unitExcluded = false;
+        unitStart = counts;
+    }
+
+    // end of a unit, with the measures of a unit inside of an archive, or of a root unit that is not an archive
+    void endUnit() {
+
+        if ((unitDepth == 2 || (unitDepth == 1 && !nestedUnits)) && !unitExcluded) {
+            const FactCounters measures = counts.since(unitStart);
+            ++selectedFiles;
+            selectedCounts.merge(measures);
+            if (unitCache && !unitCached && !unitHash.empty())
+                unitCache->insert(unitHash, measures);
+            if (unitOutput)
+                writeRecord(measures);
+            if (byLanguage)
+                addLanguage(unitLanguage, 1, measures);
+        }
+        unitExcluded = false;
+        --unitDepth;
+    }
+
+    /*
+        Check the filters of the current unit. A unit without a filename,
+        or without a language, e.g., the root unit of an archive, passes
+        that filter.
+
+        @return If the unit is selected
+    */
+    bool unitSelected() const {
+
+        if (!unitFilename.empty()) {
+            for (const auto& pattern : excludePatterns) {
+                if (matchGlob(pattern, unitFilename))
+                    return false;
+            }
+        }
+        if (selectedLanguages.empty() || unitLanguage.empty())
+            return true;
+
+        return std::any_of(selectedLanguages.begin(), selectedLanguages.end(), [this](const std::string& language) {
+            return std::equal(language.begin(), language.end(), unitLanguage.begin(), unitLanguage.end(), [](char first, char second) {
+                return std::tolower(static_cast<unsigned char>(first)) == std::tolower(static_cast<unsigned char>(second));
+            });
+        });
+    }
+
+    /*
+        Add the measures of units to their language
+
+        @param[in] language Language attribute of the units
+        @param[in] files Number of units
+        @param[in] measures Measures of the units
+    */
+    void addLanguage(const std::string& language, std::uint64_t files, const FactCounters& measures) {
+
+        auto& total = languageMeasures[language];
+        total.files += files;
+        total.measures.merge(measures);
+    }
+
+    /*
+        Write the record of a unit as a line of JSON
+
+        @param[in] measures Measures of the unit
+    */
+    void writeRecord(const FactCounters& measures) {
+
+        record.clear();
+        record += "{\"filename\":";
+        appendJSONString(record, unitFilename);
+        record += ",\"language\":";
+        appendJSONString(record, unitLanguage);
+        record += ",\"hash\":";
+        appendJSONString(record, unitHash);
+        record += ",\"characters\":" + std::to_string(measures.characters);
+        record += ",\"loc\":" + std::to_string(measures.loc);
+        record += ",\"classes\":" + std::to_string(measures.elementCounts[CLASS]);
+        record += ",\"functions\":" + std::to_string(measures.elementCounts[FUNCTION]);
+        record += ",\"declarations\":" + std::to_string(measures.elementCounts[DECL]);
+        record += ",\"expressions\":" + std::to_string(measures.elementCounts[EXPR]);
+        record += ",\"comments\":" + std::to_string(measures.elementCounts[COMMENT]);
+        record += "}\n";
+        // handlers of other files may share the output
+        std::lock_guard<std::mutex> lock(unitOutputMutex);
+        unitOutput->write(record.data(), record.size());
+        unitOutput->flush();
+    }
+
+    /*
+        Match a name with a glob pattern.
+
+        @param[in] pattern Pattern, where '*' matches any characters, and '?' any one character
+        @param[in] name Name to match
+        @return If the pattern matches the entire name
+    */
+    static bool matchGlob(std::string_view pattern, std::string_view name) {
+
+        // on a mismatch, the last '*' matches one more character
+        std::size_t p = 0;
+        std::size_t n = 0;
+        std::size_t star = std::string_view::npos;
+        std::size_t starName = 0;
+        while (n < name.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                ++p;
+                ++n;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                star = p++;
+                starName = n;
+            } else if (star != std::string_view::npos) {
+                p = star + 1;
+                n = ++starName;
+            } else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*')
+            ++p;
+
+        return p == pattern.size();
+    }
+
+    /*
+        Append an attribute value as a JSON string, with the predefined
+        XML entities replaced, or null when empty.
+
+        @param[in, out] json JSON text
+        @param[in] value Attribute value
+    */
+    static void appendJSONString(std::string& json, std::string_view value) {
+
+        using namespace std::literals::string_view_literals;
+        if (value.empty()) {
+            json += "null";
+            return;
+        }
+        json += '"';
+        while (!value.empty()) {
+            char c = value[0];
+            std::size_t size = 1;
+            if (c == '&') {
+                for (const auto& [entity, character] : { std::pair{ "&lt;"sv, '<' }, std::pair{ "&gt;"sv, '>' },
+                        std::pair{ "&amp;"sv, '&' }, std::pair{ "&quot;"sv, '"' }, std::pair{ "&apos;"sv, '\'' } }) {
+                    if (value.compare(0, entity.size(), entity) == 0) {
+                        c = character;
+                        size = entity.size();
+                        break;
+                    }
+                }
+            }
+            value.remove_prefix(size);
+            if (c == '"' || c == '\\') {
+                json += '\\';
+                json += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                const char hex[] = "0123456789abcdef";
+                json += "\\u00";
+                json += hex[c >> 4];
+                json += hex[c & 0xF];
+            } else {
+                json += c;
+            }
+        }
+        json += '"';
+    }
+
+    std::string urlValue;
+    FactCounters counts;
+    bool inEscape = false;
+
+    // per-unit records and cache
+    bool trackUnits = false;
+    std::ostream* unitOutput = nullptr;
+    UnitCache* unitCache = nullptr;
+    bool unitCached = false;
+    std::vector<std::string> excludePatterns;
+    std::vector<std::string> selectedLanguages;
+    bool unitExcluded = false;
+    bool byLanguage = false;
+    std::map<std::string, LanguageMeasures> languageMeasures;
+    static inline std::mutex unitOutputMutex;
+    bool inUnitTag = false;
+    int unitDepth = 0;
+    bool nestedUnits = false;
+    std::string unitFilename;
+    std::string unitLanguage;
+    std::string unitHash;
+    FactCounters unitStart;
+    std::uint64_t selectedFiles = 0;
+    FactCounters selectedCounts;
+    std::string record;
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*
+    tokenStats.cpp
+
+    Implementation of the totals of the token statistics of the XML parser.
+
+    The time stamp counter is calibrated against the steady clock from the
+    start of the program to the report, so the ticks are reported as
+    nanoseconds.
+*/
+
+#include "tokenStats.hpp"
+#include <mutex>
+#include <iomanip>
+
+namespace {
+
+    // parsers on other threads add their statistics
+    std::mutex mutex;
+    TokenStats totals;
+
+    // calibration of the ticks at the start of the program
+    const auto startTime = std::chrono::steady_clock::now();
+    const std::uint64_t startTicks = tokenTicks();
+}
+
+/*
+    Add the statistics of a parser to the totals
+
+    @param[in] stats Statistics of a parser
+*/
+void addTokenStats(const TokenStats& stats) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int type = 0; type < TOKEN_TYPES; ++type) {
+        totals.counts[type] += stats.counts[type];
+        totals.bytes[type] += stats.bytes[type];
+        totals.ticks[type] += stats.ticks[type];
+    }
+}
+
+/*
+    Output the totals as a table, with the ticks converted to nanoseconds
+
+    @param[in] output Stream of the table
+*/
+void reportTokenStats(std::ostream& output) {
+
+    const auto elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+    const std::uint64_t elapsedTicks = tokenTicks() - startTicks;
+    const double nanosecondsPerTick = elapsedTicks != 0 ? static_cast<double>(elapsedTime) / static_cast<double>(elapsedTicks) : 1.0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    double totalNanoseconds = 0;
+    for (int type = 0; type < TOKEN_TYPES; ++type)
+        totalNanoseconds += static_cast<double>(totals.ticks[type]) * nanosecondsPerTick;
+
+    const auto flags = output.flags();
+    const auto precision = output.precision();
+    output << std::fixed;
+    output << '\n';
+    output << "| Token      |        Count |          Bytes | Bytes/token |      Time ms | ns/token | Ticks/token | Time % |\n";
+    output << "|:-----------|-------------:|---------------:|------------:|-------------:|---------:|------------:|-------:|\n";
+    for (int type = 0; type < TOKEN_TYPES; ++type) {
+        const double count = static_cast<double>(totals.counts[type]);
+        const double nanoseconds = static_cast<double>(totals.ticks[type]) * nanosecondsPerTick;
+        output << "| " << std::left << std::setw(10) << TOKEN_TYPE_NAMES[type] << std::right
+               << " | " << std::setw(12) << totals.counts[type]
+               << " | " << std::setw(14) << totals.bytes[type]
+               << " | " << std::setw(11) << std::setprecision(1) << (count != 0 ? static_cast<double>(totals.bytes[type]) / count : 0.0)
+               << " | " << std::setw(12) << std::setprecision(3) << nanoseconds / 1e6
+               << " | " << std::setw(8) << std::setprecision(1) << (count != 0 ? nanoseconds / count : 0.0)
+               << " | " << std::setw(11) << std::setprecision(1) << (count != 0 ? static_cast<double>(totals.ticks[type]) / count : 0.0)
+               << " | " << std::setw(6) << std::setprecision(1) << (totalNanoseconds != 0 ? 100 * nanoseconds / totalNanoseconds : 0.0)
+               << " |\n";
+    }
+    output.flags(flags);
+    output.precision(precision);
+}
@@ -0,0 +1,95 @@
+/*
+    tokenStats.hpp
+
+    Statistics of the tokens of the XML parser: the number of each type of
+    token, the bytes of input they cover, and the time spent parsing them,
+    i.e., in each branch of the main loop of the parser. The time includes
+    the handler callbacks.
+
+    The parser collects the statistics only when built with TOKEN_STATS,
+    otherwise the macros that collect them compile away. Each parser
+    counts its own tokens, and adds them to the totals when destroyed.
+*/
+
+#ifndef INCLUDED_TOKENSTATS_HPP
+#define INCLUDED_TOKENSTATS_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <x86intrin.h>
+#define TOKEN_STATS_TSC
+#endif
+
+// types of tokens
+enum TokenType { TOKEN_START_TAG, TOKEN_END_TAG, TOKEN_ATTRIBUTE, TOKEN_NAMESPACE, TOKEN_CHARACTERS, TOKEN_ENTITY,
+                 TOKEN_COMMENT, TOKEN_CDATA, TOKEN_PI, TOKEN_TYPES };
+
+// names of the token types, in the order of TokenType
+constexpr const char* TOKEN_TYPE_NAMES[] = { "start tag", "end tag", "attribute", "namespace", "characters", "entity",
+                                             "comment", "CDATA", "PI" };
+
+/*
+    Current time in ticks, i.e., the time stamp counter on x86, otherwise
+    nanoseconds of the steady clock
+
+    @return Ticks
+*/
+inline std::uint64_t tokenTicks() {
+
+#ifdef TOKEN_STATS_TSC
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// counts, bytes, and ticks of each type of token
+struct TokenStats {
+    std::uint64_t counts[TOKEN_TYPES] = {};
+    std::uint64_t bytes[TOKEN_TYPES] = {};
+    std::uint64_t ticks[TOKEN_TYPES] = {};
+
+    // start of the current token
+    std::uint64_t startTicks = 0;
+    long startPosition = 0;
+
+    // start a token at a position of the input
+    void start(long position) {
+
+        startTicks = tokenTicks();
+        startPosition = position;
+    }
+
+    // add the time and bytes since the start to a token, without counting it
+    void pause(TokenType type, long position) {
+
+        ticks[type] += tokenTicks() - startTicks;
+        bytes[type] += position - startPosition;
+    }
+
+    // end a token, and count it
+    void end(TokenType type, long position) {
+
+        pause(type, position);
+        ++counts[type];
+    }
+};
+
+/*
+    Add the statistics of a parser to the totals
+
+    @param[in] stats Statistics of a parser
+*/
+void addTokenStats(const TokenStats& stats);
+
+/*
+    Output the totals as a table, with the ticks converted to nanoseconds
+
+    @param[in] output Stream of the table
+*/
+void reportTokenStats(std::ostream& output);
+
+#endif
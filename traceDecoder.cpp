@@ -0,0 +1,268 @@
+/*
+    traceDecoder.cpp
+
+    Decoder of the binary trace of srcfacts --trace. The text of each event
+    is taken from the input at the offset of the event, and the event is
+    output in the human-readable trace format, one event per line.
+
+    The blocks of each thread are in order. A parallel parse traces each
+    segment of the input as a run of events that starts with a segment
+    event, so the runs of all threads are output in the order of the
+    input.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include "traceEvents.hpp"
+#include "mapContent.hpp"
+#include "decompressContent.hpp"
+#include "scanContent.hpp"
+
+using namespace std::literals::string_view_literals;
+
+namespace {
+
+    // header of an event, in the trace format
+    void header(std::string_view name) {
+
+        std::cout << "\033[1m" << std::setw(10) << std::left << name << "\u001b[0m" << '\t';
+    }
+
+    // field of an event, in the trace format
+    void field(std::string_view label, std::string_view value) {
+
+        std::cout << "\033[1m" << label << "\u001b[0m" << "|" << "\u001b[31;1m" << value << "\u001b[0m" << "| ";
+    }
+
+    // prefix and local name of a qualified name
+    std::pair<std::string_view, std::string_view> splitName(std::string_view qName) {
+
+        const std::size_t colonPosition = qName.find(':');
+        if (colonPosition == qName.npos)
+            return { ""sv, qName };
+
+        return { qName.substr(0, colonPosition), qName.substr(colonPosition + 1) };
+    }
+
+    /*
+        Value of the attribute at the start of a span, after the name
+
+        @param[in] span Text from the end of the name to the closing delimiter
+        @return Value without the delimiters
+    */
+    std::string_view attributeValue(std::string_view span) {
+
+        const std::size_t valueStart = span.find_first_of("\"'"sv);
+        if (valueStart == span.npos)
+            return ""sv;
+        const std::size_t valueEnd = span.find(span[valueStart], valueStart + 1);
+
+        return span.substr(valueStart + 1, valueEnd == span.npos ? span.npos : valueEnd - valueStart - 1);
+    }
+
+    /*
+        Output an event in the trace format
+
+        @param[in] type Type of the event
+        @param[in] text Text of the event in the input
+    */
+    void decodeEvent(int type, std::string_view text) {
+
+        switch (type) {
+        case TRACE_START_DOCUMENT:
+            header("START DOCUMENT");
+            break;
+        case TRACE_END_DOCUMENT:
+            header("END DOCUMENT");
+            break;
+        case TRACE_XML_DECLARATION: {
+            // pseudo-attributes of "<?xml ... ?>"
+            std::string_view values[3];
+            constexpr std::string_view names[3] = { "version"sv, "encoding"sv, "standalone"sv };
+            std::string_view attributes = text.substr("<?xml"sv.size());
+            std::size_t nameStart = 0;
+            while ((nameStart = attributes.find_first_not_of(" \t\r\n"sv)) != attributes.npos && attributes[nameStart] != '?') {
+                const std::size_t nameEnd = attributes.find_first_of("= \t\r\n"sv, nameStart);
+                const std::size_t valueStart = attributes.find_first_of("\"'"sv, nameEnd);
+                if (valueStart == attributes.npos)
+                    break;
+                const std::size_t valueEnd = attributes.find(attributes[valueStart], valueStart + 1);
+                if (valueEnd == attributes.npos)
+                    break;
+                const std::string_view name = attributes.substr(nameStart, nameEnd - nameStart);
+                for (int index = 0; index < 3; ++index) {
+                    if (name == names[index])
+                        values[index] = attributes.substr(valueStart + 1, valueEnd - valueStart - 1);
+                }
+                attributes.remove_prefix(valueEnd + 1);
+            }
+            header("XML DECLARATION");
+            for (int index = 0; index < 3; ++index)
+                field(names[index], values[index]);
+            break;
+        }
+        case TRACE_DOCTYPE:
+            header("DOCTYPE");
+            field("contents", text);
+            break;
+        case TRACE_CHARACTERS: {
+            // character entity references are traced as their text
+            std::string_view characters = text;
+            if (text == "&lt;"sv)
+                characters = "<"sv;
+            else if (text == "&gt;"sv)
+                characters = ">"sv;
+            else if (text == "&amp;"sv)
+                characters = "&"sv;
+            header("CHARACTERS");
+            field("characters", characters);
+            break;
+        }
+        case TRACE_COMMENT:
+            header("COMMENT");
+            field("content", text);
+            break;
+        case TRACE_CDATA:
+            header("CDATA");
+            field("characters", text);
+            break;
+        case TRACE_PI: {
+            const std::size_t nameEndPosition = std::min(findNameEnd(text), text.size());
+            header("PI");
+            field("target", text.substr(0, nameEndPosition));
+            field("data", text.substr(nameEndPosition));
+            break;
+        }
+        case TRACE_START_TAG:
+        case TRACE_END_TAG: {
+            const auto [prefix, localName] = splitName(text);
+            header(type == TRACE_START_TAG ? "START TAG" : "END TAG");
+            field("qName", text);
+            field("prefix", prefix);
+            field("localName", localName);
+            break;
+        }
+        case TRACE_NAMESPACE: {
+            // "xmlns:prefix = 'uri'"
+            const std::size_t equalPosition = text.find('=');
+            std::string_view prefix = text.substr("xmlns"sv.size(), equalPosition - "xmlns"sv.size());
+            if (!prefix.empty() && prefix[0] == ':')
+                prefix.remove_prefix(":"sv.size());
+            prefix = prefix.substr(0, prefix.find_first_of(" \t\r\n"sv));
+            header("NAMESPACE");
+            field("prefix", prefix);
+            field("uri", attributeValue(text.substr(equalPosition)));
+            break;
+        }
+        case TRACE_ATTRIBUTE: {
+            // "prefix:name = 'value'"
+            const std::string_view qName = text.substr(0, text.find_first_of("= \t\r\n"sv));
+            const auto [prefix, localName] = splitName(qName);
+            header("ATTRIBUTE");
+            field("qname", qName);
+            field("prefix", prefix);
+            field("localName", localName);
+            field("value", attributeValue(text.substr(text.find('='))));
+            break;
+        }
+        }
+        std::cout << '\n';
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    bool timestamps = false;
+    std::vector<std::string_view> paths;
+    for (int arg = 1; arg < argc; ++arg) {
+        const std::string_view option(argv[arg]);
+        if (option == "--timestamps"sv)
+            timestamps = true;
+        else
+            paths.push_back(option);
+    }
+    if (paths.size() != 2) {
+        std::cerr << "usage: tracedecode [--timestamps] trace-file input-file\n";
+        return 1;
+    }
+
+    // events of each thread in order
+    std::ifstream traceFile(std::string(paths[0]), std::ios::binary);
+    char magic[sizeof(TRACE_MAGIC)] = {};
+    std::uint32_t format[2] = {};
+    traceFile.read(magic, sizeof(magic));
+    traceFile.read(reinterpret_cast<char*>(format), sizeof(format));
+    if (!traceFile || !std::equal(magic, magic + sizeof(magic), TRACE_MAGIC) || format[0] != TRACE_VERSION || format[1] != sizeof(TraceEvent)) {
+        std::cerr << "tracedecode : Invalid trace file " << paths[0] << '\n';
+        return 1;
+    }
+    std::map<std::uint32_t, std::vector<TraceEvent>> threadEvents;
+    TraceBlock block;
+    while (traceFile.read(reinterpret_cast<char*>(&block), sizeof(block))) {
+        auto& events = threadEvents[block.thread];
+        const std::size_t start = events.size();
+        events.resize(start + block.events);
+        if (!traceFile.read(reinterpret_cast<char*>(events.data() + start), block.events * sizeof(TraceEvent))) {
+            std::cerr << "tracedecode : Incomplete trace file " << paths[0] << '\n';
+            return 1;
+        }
+    }
+
+    // input, decompressed when compressed
+    const int fd = open(std::string(paths[1]).c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "tracedecode : Unable to open file " << paths[1] << '\n';
+        return 1;
+    }
+    std::string_view input;
+    const long bytesMapped = mapContent(fd, input);
+    close(fd);
+    if (bytesMapped <= 0) {
+        std::cerr << "tracedecode : Unable to map file " << paths[1] << '\n';
+        return 1;
+    }
+    std::string buffer;
+    if (detectCompression(input) != Compression::NONE) {
+        const long bytes = decompressContent(input, buffer);
+        if (bytes <= 0)
+            return 1;
+        input = std::string_view(buffer.data(), bytes);
+    }
+
+    // runs of events start at a document or a segment, in the order of the input
+    std::vector<std::pair<const TraceEvent*, const TraceEvent*>> runs;
+    for (const auto& [thread, events] : threadEvents) {
+        for (std::size_t event = 0; event < events.size(); ++event) {
+            if (runs.empty() || event == 0 || events[event].type == TRACE_START_DOCUMENT || events[event].type == TRACE_SEGMENT)
+                runs.emplace_back(&events[event], &events[event] + 1);
+            else
+                runs.back().second = &events[event] + 1;
+        }
+    }
+    std::stable_sort(runs.begin(), runs.end(), [](const auto& first, const auto& second) {
+        return first.first->offset < second.first->offset;
+    });
+    for (const auto& [begin, end] : runs) {
+        for (const TraceEvent* event = begin; event != end; ++event) {
+            if (event->type == TRACE_SEGMENT)
+                continue;
+            if (event->offset + event->length > input.size() || event->type >= TRACE_EVENT_TYPES) {
+                std::cerr << "tracedecode : Trace does not match the input " << paths[1] << '\n';
+                return 1;
+            }
+            if (timestamps)
+                std::cout << std::right << std::setw(12) << event->timestamp << ' ';
+            decodeEvent(event->type, input.substr(event->offset, event->length));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+    traceEvents.cpp
+
+    Implementation of the binary trace of the parsing events.
+
+    The buffer of a thread is allocated on its first event. A full buffer
+    is written to the trace file, opened for append, as one block with a
+    single write, so blocks of threads do not interleave and no event is
+    dropped. The remaining events of a thread are written when the thread
+    exits, or for the calling thread, when tracing stops.
+*/
+
+#include "traceEvents.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <iostream>
+
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+namespace {
+
+    // events in the buffer of a thread
+    const std::size_t TRACE_BUFFER_EVENTS = 1 << 14;
+
+    // trace file, -1 when not tracing
+    int traceFile = -1;
+
+    std::chrono::steady_clock::time_point traceStart;
+
+    std::atomic<std::uint32_t> nextThread{ 0 };
+
+    std::atomic<bool> writeError{ false };
+
+    // events of a thread, written when full and when the thread exits
+    struct TraceBuffer {
+        std::unique_ptr<TraceEvent[]> events{ new TraceEvent[TRACE_BUFFER_EVENTS] };
+        std::uint32_t count = 0;
+        const std::uint32_t thread = nextThread++;
+
+        ~TraceBuffer() {
+
+            write();
+        }
+
+        // write the events as a block
+        void write() {
+
+            if (count == 0 || traceFile == -1)
+                return;
+#if !defined(_MSC_VER)
+            TraceBlock block{ thread, count };
+            iovec parts[2] = { { &block, sizeof(block) }, { events.get(), count * sizeof(TraceEvent) } };
+            const ssize_t size = static_cast<ssize_t>(sizeof(block) + count * sizeof(TraceEvent));
+            if (writev(traceFile, parts, 2) != size)
+                writeError = true;
+#endif
+            count = 0;
+        }
+    };
+
+    thread_local std::unique_ptr<TraceBuffer> buffer;
+}
+
+/*
+    Start tracing into a file
+
+    @param[in] path Path of the trace file, created or truncated
+    @return Status
+    @retval 0 Success
+    @retval -1 Unable to create the file, with the message on standard error
+*/
+[[nodiscard]] int startTracing(const std::string& path) {
+
+#if !defined(_MSC_VER)
+    traceFile = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+#endif
+    if (traceFile == -1) {
+        std::cerr << "srcfacts : Unable to create trace " << path << '\n';
+        return -1;
+    }
+    const std::uint32_t header[2] = { TRACE_VERSION, sizeof(TraceEvent) };
+    if (write(traceFile, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != sizeof(TRACE_MAGIC) ||
+        write(traceFile, header, sizeof(header)) != sizeof(header)) {
+        std::cerr << "srcfacts : Unable to write trace " << path << '\n';
+        return -1;
+    }
+    traceStart = std::chrono::steady_clock::now();
+    traceEnabled = true;
+
+    return 0;
+}
+
+/*
+    Record an event of the calling thread
+
+    @param[in] type Type of the event
+    @param[in] offset Offset of the text of the event in the input
+    @param[in] length Length of the text of the event
+*/
+void traceEvent(TraceEventType type, long offset, std::size_t length) {
+
+    if (!buffer)
+        buffer = std::make_unique<TraceBuffer>();
+    TraceEvent& event = buffer->events[buffer->count];
+    event.timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStart).count());
+    event.offset = static_cast<std::uint64_t>(offset);
+    event.length = static_cast<std::uint32_t>(length);
+    event.type = type;
+    event.reserved = 0;
+    if (++buffer->count == TRACE_BUFFER_EVENTS)
+        buffer->write();
+}
+
+/*
+    Stop tracing, and write the events of the calling thread. Other
+    threads write their events when they exit, so they are joined before.
+
+    @return Status
+    @retval 0 Success
+    @retval -1 Write error, with the message on standard error
+*/
+[[nodiscard]] int stopTracing() {
+
+    if (traceFile == -1)
+        return 0;
+    traceEnabled = false;
+    if (buffer)
+        buffer->write();
+    if (close(traceFile) != 0)
+        writeError = true;
+    traceFile = -1;
+    if (writeError) {
+        std::cerr << "srcfacts : Unable to write trace\n";
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+    traceEvents.hpp
+
+    Binary trace of the parsing events of the XML parser. Tracing is
+    compiled in, and enabled at runtime, so a disabled trace costs a test
+    of a flag for each event.
+
+    Each event is recorded as its type, the offset and length of its text
+    in the input, and a timestamp. The text itself is not recorded, so a
+    trace is decoded together with the input, e.g., by tracedecode. Each
+    thread records events into its own buffer without locks, and writes a
+    full buffer to the trace file as a block with a single write.
+
+    Trace file format, in native byte order:
+    * Header: TRACE_MAGIC, format version, size of an event
+    * Blocks: number of the thread, number of events, and the events
+*/
+
+#ifndef INCLUDED_TRACEEVENTS_HPP
+#define INCLUDED_TRACEEVENTS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// types of trace events
+enum TraceEventType : std::uint16_t { TRACE_START_DOCUMENT, TRACE_END_DOCUMENT, TRACE_XML_DECLARATION, TRACE_DOCTYPE,
+                                      TRACE_CHARACTERS, TRACE_COMMENT, TRACE_CDATA, TRACE_PI, TRACE_START_TAG,
+                                      TRACE_END_TAG, TRACE_NAMESPACE, TRACE_ATTRIBUTE, TRACE_SEGMENT, TRACE_EVENT_TYPES };
+
+// event of the trace, with the span of its text in the input
+struct TraceEvent {
+    std::uint64_t timestamp;
+    std::uint64_t offset;
+    std::uint32_t length;
+    std::uint16_t type;
+    std::uint16_t reserved;
+};
+
+// header of a block of events of a thread
+struct TraceBlock {
+    std::uint32_t thread;
+    std::uint32_t events;
+};
+
+// start of a trace file
+constexpr char TRACE_MAGIC[8] = { 's', 'r', 'c', 'f', 't', 'r', 'c', '\n' };
+constexpr std::uint32_t TRACE_VERSION = 1;
+
+// tracing is enabled
+inline bool traceEnabled = false;
+
+/*
+    Start tracing into a file
+
+    @param[in] path Path of the trace file, created or truncated
+    @return Status
+    @retval 0 Success
+    @retval -1 Unable to create the file, with the message on standard error
+*/
+[[nodiscard]] int startTracing(const std::string& path);
+
+/*
+    Record an event of the calling thread
+
+    @param[in] type Type of the event
+    @param[in] offset Offset of the text of the event in the input
+    @param[in] length Length of the text of the event
+*/
+void traceEvent(TraceEventType type, long offset, std::size_t length);
+
+/*
+    Stop tracing, and write the events of the calling thread. Other
+    threads write their events when they exit, so they are joined before.
+
+    @return Status
+    @retval 0 Success
+    @retval -1 Write error, with the message on standard error
+*/
+[[nodiscard]] int stopTracing();
+
+#endif
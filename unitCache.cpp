@@ -0,0 +1,137 @@
+/*
+    unitCache.cpp
+
+    Implementation of the persistent cache of the srcFacts measures of units.
+*/
+
+#include "unitCache.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+
+    /*
+        Header line of the cache file. A change in the counted elements
+        changes the header, so an older cache is ignored.
+
+        @return Header line
+    */
+    std::string cacheHeader() {
+
+        std::string header = "srcfacts-cache 1";
+        for (const auto name : COUNTED_ELEMENT_NAMES) {
+            header += ' ';
+            header += name;
+        }
+
+        return header;
+    }
+}
+
+/*
+    Load the cache from a file. A missing file is an empty cache.
+
+    @param[in] path Path of the cache file
+    @return Status
+    @retval 0 Success
+    @retval -1 Unreadable file, with the message on standard error
+*/
+[[nodiscard]] int UnitCache::load(const std::string& path) {
+
+    std::ifstream file(path);
+    if (!file) {
+        std::error_code error;
+        if (!std::filesystem::exists(path, error))
+            return 0;
+        std::cerr << "srcfacts : Unable to read cache " << path << '\n';
+        return -1;
+    }
+    std::string line;
+    if (!std::getline(file, line) || line != cacheHeader())
+        return 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string hash;
+        FactCounters measures;
+        fields >> hash >> measures.characters >> measures.loc;
+        for (auto& count : measures.elementCounts)
+            fields >> count;
+        if (fields)
+            units[hash] = measures;
+    }
+
+    return 0;
+}
+
+/*
+    Save the cache to a file, when units were added. The file is
+    written under a temporary name, then renamed.
+
+    @param[in] path Path of the cache file
+    @return Status
+    @retval 0 Success
+    @retval -1 Unwritable file, with the message on standard error
+*/
+[[nodiscard]] int UnitCache::save(const std::string& path) const {
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!modified)
+        return 0;
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath);
+        file << cacheHeader() << '\n';
+        for (const auto& [hash, measures] : units) {
+            file << hash << ' ' << measures.characters << ' ' << measures.loc;
+            for (const auto count : measures.elementCounts)
+                file << ' ' << count;
+            file << '\n';
+        }
+        if (!file) {
+            std::cerr << "srcfacts : Unable to write cache " << path << '\n';
+            return -1;
+        }
+    }
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "srcfacts : Unable to write cache " << path << '\n';
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+    Find the measures of a unit.
+
+    @param[in] hash Hash attribute of the unit
+    @param[out] measures Measures of the unit, when found
+    @return If the unit is in the cache
+*/
+bool UnitCache::find(std::string_view hash, FactCounters& measures) const {
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto unit = units.find(std::string(hash));
+    if (unit == units.end())
+        return false;
+    measures = unit->second;
+
+    return true;
+}
+
+/*
+    Add the measures of a unit.
+
+    @param[in] hash Hash attribute of the unit
+    @param[in] measures Measures of the unit
+*/
+void UnitCache::insert(std::string_view hash, const FactCounters& measures) {
+
+    std::lock_guard<std::mutex> lock(mutex);
+    units[std::string(hash)] = measures;
+    modified = true;
+}
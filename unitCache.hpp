@@ -0,0 +1,70 @@
+/*
+    unitCache.hpp
+
+    Persistent cache of the srcFacts measures of units, keyed by the hash
+    attribute of the unit. A unit found in the cache is not parsed again.
+
+    The cache file is text, with a header line that names the format
+    version and the counted elements, followed by a line for each unit:
+    the hash, characters, LOC, and the count of each counted element. A
+    cache with a different header is ignored.
+*/
+
+#ifndef INCLUDED_UNITCACHE_HPP
+#define INCLUDED_UNITCACHE_HPP
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <mutex>
+#include "factCounters.hpp"
+
+class UnitCache {
+public:
+
+    /*
+        Load the cache from a file. A missing file is an empty cache.
+
+        @param[in] path Path of the cache file
+        @return Status
+        @retval 0 Success
+        @retval -1 Unreadable file, with the message on standard error
+    */
+    [[nodiscard]] int load(const std::string& path);
+
+    /*
+        Save the cache to a file, when units were added. The file is
+        written under a temporary name, then renamed.
+
+        @param[in] path Path of the cache file
+        @return Status
+        @retval 0 Success
+        @retval -1 Unwritable file, with the message on standard error
+    */
+    [[nodiscard]] int save(const std::string& path) const;
+
+    /*
+        Find the measures of a unit.
+
+        @param[in] hash Hash attribute of the unit
+        @param[out] measures Measures of the unit, when found
+        @return If the unit is in the cache
+    */
+    bool find(std::string_view hash, FactCounters& measures) const;
+
+    /*
+        Add the measures of a unit.
+
+        @param[in] hash Hash attribute of the unit
+        @param[in] measures Measures of the unit
+    */
+    void insert(std::string_view hash, const FactCounters& measures);
+
+private:
+    // handlers of a multiple-file run share the cache
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, FactCounters> units;
+    bool modified = false;
+};
+
+#endif
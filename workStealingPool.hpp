@@ -0,0 +1,78 @@
+/*
+    workStealingPool.hpp
+
+    Work-stealing thread pool for srcFacts. Tasks are dealt to the
+    workers in order, each worker runs the tasks from the front of its
+    own queue, and an idle worker steals from the back of the queue of
+    another worker. With the tasks ordered largest first, each worker
+    starts on a large task, and the small tasks at the end balance the
+    load.
+*/
+
+#ifndef INCLUDED_WORKSTEALINGPOOL_HPP
+#define INCLUDED_WORKSTEALINGPOOL_HPP
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <optional>
+#include <cstddef>
+
+/*
+    Run tasks on a work-stealing thread pool.
+
+    @param[in] tasks Number of tasks, run in order of their index
+    @param[in] threads Number of worker threads
+    @param[in] task Function that runs the task of an index
+*/
+template <class Task>
+void runWorkStealing(std::size_t tasks, int threads, Task task) {
+
+    if (threads < 1)
+        threads = 1;
+
+    // queue of task indexes of each worker
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+    std::vector<WorkQueue> queues(threads);
+    for (std::size_t index = 0; index < tasks; ++index)
+        queues[index % threads].tasks.push_back(index);
+
+    // next task of a worker, from its own queue or stolen
+    const auto nextTask = [&](int worker) -> std::optional<std::size_t> {
+        {
+            std::lock_guard<std::mutex> lock(queues[worker].mutex);
+            if (!queues[worker].tasks.empty()) {
+                const std::size_t index = queues[worker].tasks.front();
+                queues[worker].tasks.pop_front();
+                return index;
+            }
+        }
+        for (int offset = 1; offset < threads; ++offset) {
+            WorkQueue& victim = queues[(worker + offset) % threads];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                const std::size_t index = victim.tasks.back();
+                victim.tasks.pop_back();
+                return index;
+            }
+        }
+        return std::nullopt;
+    };
+    const auto runWorker = [&](int worker) {
+        while (const auto index = nextTask(worker))
+            task(*index);
+    };
+
+    std::vector<std::thread> workers;
+    for (int worker = 1; worker < threads; ++worker)
+        workers.emplace_back(runWorker, worker);
+    runWorker(0);
+    for (auto& worker : workers)
+        worker.join();
+}
+
+#endif
@@ -0,0 +1,1007 @@
+/*
+    xmlParser.hpp
+
+    Streaming XML parser with the parsing events delivered to a handler.
+
+    The handler is a template parameter, and its callbacks are called
+    directly, so callbacks the handler does not define, i.e., the empty
+    ones of XMLParserHandler, compile away.
+
+    The parser is complete for XML:
+    * Characters and content from XML is in UTF-8
+    * DTD declarations are allowed, but not fine-grained parsed
+    * No checking for well-formedness
+
+    Streamed content is a window of the input. A token that the end of the
+    content interrupts, i.e., a start tag between attributes, a comment, or
+    a CDATA section, is resumed after the next refill, from the state of
+    the parser. A comment or CDATA section is delivered in parts, so a
+    large one takes no more memory than a small one.
+*/
+
+#ifndef INCLUDED_XMLPARSER_HPP
+#define INCLUDED_XMLPARSER_HPP
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <algorithm>
+#include <cassert>
+#include "refillContent.hpp"
+#include "scanContent.hpp"
+#include "tokenStats.hpp"
+#include "traceEvents.hpp"
+
+// token statistics, cmake -DTOKEN_STATS=ON
+#ifdef TOKEN_STATS
+#define TOKEN_START() tokenStats.start(position())
+#define TOKEN_PAUSE(type) tokenStats.pause(type, position())
+#define TOKEN_END(type) tokenStats.end(type, position())
+#else
+#define TOKEN_START()
+#define TOKEN_PAUSE(type)
+#define TOKEN_END(type)
+#endif
+
+template <class Handler>
+class XMLParser {
+public:
+
+    /*
+        Constructor
+
+        @param[in, out] handler Handler of the parsing events
+        @param[in] content Entire content, e.g., mapped from a file. When
+            empty, the content is read with refillContent().
+        @param[in] offset Offset of the content in the input, for tracing a
+            segment of the input
+    */
+    XMLParser(Handler& handler, std::string_view content = std::string_view(), long offset = 0)
+        : handler(handler), content(content), doneReading(!content.empty()), totalBytesRead(content.size()), inputOffset(offset) {}
+
+    /*
+        Constructor for content read by a reader of an input other than
+        the standard input
+
+        @param[in, out] handler Handler of the parsing events
+        @param[in, out] reader Reader of the input
+    */
+    XMLParser(Handler& handler, ContentReader& reader)
+        : handler(handler), reader(&reader), doneReading(false), totalBytesRead(0), inputOffset(0) {}
+
+#ifdef TOKEN_STATS
+    // add the token statistics of this parser to the totals
+    ~XMLParser() {
+
+        addTokenStats(tokenStats);
+    }
+#endif
+
+    /*
+        Parse the XML document
+
+        @return Status of the parse
+        @retval 0 Success
+        @retval 1 Parser error, with the message on standard error
+    */
+    int parse() {
+
+        trace(TRACE_START_DOCUMENT, content.substr(0, 0));
+        handler.onStartDocument();
+        if (!doneReading) {
+            const int bytesRead = refill();
+            if (bytesRead < 0)
+                return 1;
+            if (bytesRead == 0) {
+                errors << "parser error : Empty file\n";
+                return 1;
+            }
+        }
+        depth = 0;
+        if (parseProlog() != 0 || parseElements() != 0)
+            return 1;
+        // the input ended inside of an element
+        if (depth != 0) {
+            errors << "parser error : Unterminated element\n";
+            return 1;
+        }
+        if (parseEpilog() != 0)
+            return 1;
+        trace(TRACE_END_DOCUMENT, content.substr(0, 0));
+        handler.onEndDocument();
+
+        return 0;
+    }
+
+    /*
+        Parse a segment of a document given as entire content, for parsing
+        a document in parallel. The first segment starts at the start of
+        the document, and any other segment starts at a tag inside of the
+        root element. A segment ends when the content ends, or when the
+        depth returns to 0 at the root end tag.
+
+        @param[in] startDepth Depth of elements at the start of the segment,
+            0 for the start of the document
+        @param[in] reportErrors Output parser errors, otherwise only the
+            status shows an error, e.g., for speculative parsing
+        @return Status of the parse
+        @retval 0 Success
+        @retval 1 Parser error
+    */
+    int parseSegment(int startDepth, bool reportErrors = true) {
+
+        if (!reportErrors)
+            errors.rdbuf(nullptr);
+        depth = startDepth;
+        trace(TRACE_SEGMENT, content.substr(0, 0));
+        if ((startDepth == 0 && parseProlog() != 0) || parseElements() != 0 || parseEpilog() != 0)
+            return 1;
+
+        return 0;
+    }
+
+    /*
+        Depth of elements at the end of a segment
+
+        @return Depth, i.e., number of open elements
+    */
+    int segmentDepth() const {
+
+        return depth;
+    }
+
+    /*
+        Total number of bytes of input
+
+        @return Number of bytes
+    */
+    long totalBytes() const {
+
+        return totalBytesRead;
+    }
+
+private:
+
+    /*
+        Refill the content preserving unprocessed.
+
+        @return Number of bytes read
+        @retval 0 EOF
+        @retval -1 Read error, with the message on standard error
+    */
+    int refill() {
+
+        // the name of an interrupted start tag may be in the content the refill replaces
+        if (state == ParserState::START_TAG && tagQName.data() != savedTagQName.data()) {
+            savedTagPosition = position() + (tagQName.data() - content.data());
+            savedTagQName.assign(tagQName);
+            tagQName = savedTagQName;
+        }
+        const int bytesRead = reader ? refillContent(*reader, content) : refillContent(content);
+        if (bytesRead < 0) {
+            errors << "parser error : File input error\n";
+            return -1;
+        }
+        if (bytesRead == 0)
+            doneReading = true;
+        totalBytesRead += bytesRead;
+
+        return bytesRead;
+    }
+
+    /*
+        Position in the input of the start of the content
+
+        @return Number of bytes before the content
+    */
+    long position() const {
+
+        return totalBytesRead - static_cast<long>(content.size());
+    }
+
+    /*
+        Record a trace event, when tracing
+
+        @param[in] type Type of the event
+        @param[in] span Text of the event in the content
+    */
+    void trace(TraceEventType type, std::string_view span) const {
+
+        if (traceEnabled)
+            traceEvent(type, inputOffset + position() + (span.data() - content.data()), span.size());
+    }
+
+    /*
+        Skip whitespace at the start of the content
+
+        @return If any content remains
+    */
+    bool skipWhitespace() {
+
+        const std::size_t nonWhitespacePosition = findNonWhitespace(content);
+        if (nonWhitespacePosition == content.npos) {
+            content.remove_prefix(content.size());
+            return false;
+        }
+        content.remove_prefix(nonWhitespacePosition);
+        return true;
+    }
+
+    /*
+        Parse the optional XML declaration and DOCTYPE.
+
+        @return Status of the parse
+    */
+    int parseProlog() {
+
+        using namespace std::literals::string_view_literals;
+        if (!skipWhitespace()) {
+            errors << "parser error : Empty file\n";
+            return 1;
+        }
+        if (content.size() > "<?xml "sv.size() && content[0] == '<' && content[1] == '?' && content[2] == 'x' && content[3] == 'm' && content[4] == 'l' && content[5] == ' ') {
+            // parse XML declaration
+            const char* const declarationStart = content.data();
+            assert(content.compare(0, "<?xml "sv.size(), "<?xml "sv) == 0);
+            content.remove_prefix("<?xml"sv.size());
+            if (!skipWhitespace()) {
+                errors << "parser error: Incomplete XML declaration\n";
+                return 1;
+            }
+            // parse required version
+            std::size_t nameEndPosition = content.find_first_of("= ");
+            if (nameEndPosition == content.npos) {
+                errors << "parser error: Incomplete XML declaration\n";
+                return 1;
+            }
+            const std::string_view attr(content.substr(0, nameEndPosition));
+            content.remove_prefix(nameEndPosition);
+            if (!skipWhitespace()) {
+                errors << "parser error: Incomplete XML declaration\n";
+                return 1;
+            }
+            content.remove_prefix("="sv.size());
+            if (!skipWhitespace()) {
+                errors << "parser error: Incomplete XML declaration\n";
+                return 1;
+            }
+            const char delimiter = content[0];
+            if (delimiter != '"' && delimiter != '\'') {
+                errors << "parser error: Invalid start delimiter for version in XML declaration\n";
+                return 1;
+            }
+            content.remove_prefix("\""sv.size());
+            std::size_t valueEndPosition = content.find(delimiter);
+            if (valueEndPosition == content.npos) {
+                errors << "parser error: Invalid end delimiter for version in XML declaration\n";
+                return 1;
+            }
+            if (attr != "version"sv) {
+                errors << "parser error: Missing required first attribute version in XML declaration\n";
+                return 1;
+            }
+            const std::string_view version(content.substr(0, valueEndPosition));
+            content.remove_prefix(valueEndPosition);
+            content.remove_prefix("\""sv.size());
+            if (!skipWhitespace()) {
+                errors << "parser error: Incomplete XML declaration\n";
+                return 1;
+            }
+            // parse optional encoding and standalone attributes
+            std::optional<std::string_view> encoding;
+            std::optional<std::string_view> standalone;
+            if (content[0] != '?') {
+                std::size_t nameEndPosition = content.find_first_of("= ");
+                if (nameEndPosition == content.npos) {
+                    errors << "parser error: Incomplete attribute in XML declaration\n";
+                    return 1;
+                }
+                const std::string_view attr2(content.substr(0, nameEndPosition));
+                content.remove_prefix(nameEndPosition);
+                if (!skipWhitespace()) {
+                    errors << "parser error: Incomplete XML declaration\n";
+                    return 1;
+                }
+                assert(content.compare(0, "="sv.size(), "="sv) == 0);
+                content.remove_prefix("="sv.size());
+                if (!skipWhitespace()) {
+                    errors << "parser error: Incomplete XML declaration\n";
+                    return 1;
+                }
+                char delimiter2 = content[0];
+                if (delimiter2 != '"' && delimiter2 != '\'') {
+                    errors << "parser error: Invalid end delimiter for attribute " << attr2 << " in XML declaration\n";
+                    return 1;
+                }
+                content.remove_prefix("\""sv.size());
+                std::size_t valueEndPosition = content.find(delimiter2);
+                if (valueEndPosition == content.npos) {
+                    errors << "parser error: Incomplete attribute " << attr2 << " in XML declaration\n";
+                    return 1;
+                }
+                if (attr2 == "encoding"sv) {
+                    encoding = content.substr(0, valueEndPosition);
+                } else if (attr2 == "standalone"sv) {
+                    standalone = content.substr(0, valueEndPosition);
+                } else {
+                    errors << "parser error: Invalid attribute " << attr2 << " in XML declaration\n";
+                    return 1;
+                }
+                content.remove_prefix(valueEndPosition + 1);
+                if (!skipWhitespace()) {
+                    errors << "parser error: Incomplete XML declaration\n";
+                    return 1;
+                }
+            }
+            if (content[0] != '?') {
+                std::size_t nameEndPosition = content.find_first_of("= ");
+                if (nameEndPosition == content.npos) {
+                    errors << "parser error: Incomplete attribute in XML declaration\n";
+                    return 1;
+                }
+                const std::string_view attr2(content.substr(0, nameEndPosition));
+                content.remove_prefix(nameEndPosition);
+                if (!skipWhitespace()) {
+                    errors << "parser error: Incomplete XML declaration\n";
+                    return 1;
+                }
+                content.remove_prefix("="sv.size());
+                if (!skipWhitespace()) {
+                    errors << "parser error: Incomplete XML declaration\n";
+                    return 1;
+                }
+                const char delimiter2 = content[0];
+                if (delimiter2 != '"' && delimiter2 != '\'') {
+                    errors << "parser error: Invalid end delimiter for attribute " << attr2 << " in XML declaration\n";
+                    return 1;
+                }
+                content.remove_prefix("\""sv.size());
+                std::size_t valueEndPosition = content.find(delimiter2);
+                if (valueEndPosition == content.npos) {
+                    errors << "parser error: Incomplete attribute " << attr2 << " in XML declaration\n";
+                    return 1;
+                }
+                if (!standalone && attr2 == "standalone"sv) {
+                    standalone = content.substr(0, valueEndPosition);
+                } else {
+                    errors << "parser error: Invalid attribute " << attr2 << " in XML declaration\n";
+                    return 1;
+                }
+                // assert(content[valueEndPosition + 1] == '"');
+                content.remove_prefix(valueEndPosition + 1);
+                if (!skipWhitespace()) {
+                    errors << "parser error: Incomplete XML declaration\n";
+                    return 1;
+                }
+            }
+            trace(TRACE_XML_DECLARATION, std::string_view(declarationStart, content.data() + "?>"sv.size() - declarationStart));
+            handler.onXMLDeclaration(version, encoding, standalone);
+            assert(content.compare(0, "?>"sv.size(), "?>"sv) == 0);
+            content.remove_prefix("?>"sv.size());
+            skipWhitespace();
+        }
+        if (content.size() > "<!DOCTYPE "sv.size() && content[1] == '!' && content[0] == '<' && content[2] == 'D' && content[3] == 'O' && content[4] == 'C' && content[5] == 'T' && content[6] == 'Y' && content[7] == 'P' && content[8] == 'E' && content[9] == ' ') {
+            // parse DOCTYPE
+            assert(content.compare(0, "<!DOCTYPE "sv.size(), "<!DOCTYPE "sv) == 0);
+            content.remove_prefix("<!DOCTYPE"sv.size());
+            int depthAngleBrackets = 1;
+            bool inSingleQuote = false;
+            bool inDoubleQuote = false;
+            bool inComment = false;
+            std::size_t p = 0;
+            while ((p = content.find_first_of("<>'\"-"sv, p)) != content.npos) {
+                if (content.compare(p, "<!--"sv.size(), "<!--"sv) == 0) {
+                    inComment = true;
+                    p += "<!--"sv.size();
+                    continue;
+                } else if (content.compare(p, "-->"sv.size(), "-->"sv) == 0) {
+                    inComment = false;
+                    p += "-->"sv.size();
+                    continue;
+                }
+                if (inComment) {
+                    ++p;
+                    continue;
+                }
+                if (content[p] == '<' && !inSingleQuote && !inDoubleQuote) {
+                    ++depthAngleBrackets;
+                } else if (content[p] == '>' && !inSingleQuote && !inDoubleQuote) {
+                    --depthAngleBrackets;
+                } else if (content[p] == '\'') {
+                    inSingleQuote = !inSingleQuote;
+                } else if (content[p] == '"') {
+                    inDoubleQuote = !inDoubleQuote;
+                }
+                if (depthAngleBrackets == 0)
+                    break;
+                ++p;
+            }
+            const std::string_view contents(content.substr(0, p));
+            trace(TRACE_DOCTYPE, contents);
+            handler.onDoctype(contents);
+            content.remove_prefix(p);
+            assert(content[0] == '>');
+            content.remove_prefix(">"sv.size());
+            skipWhitespace();
+        }
+
+        return 0;
+    }
+
+    /*
+        Parse the root element, or the rest of it from the current depth.
+
+        @return Status of the parse
+    */
+    int parseElements() {
+
+        using namespace std::literals::string_view_literals;
+        while (true) {
+            if (doneReading) {
+                // an interrupted token at the end of the input is unterminated
+                if (content.empty() && state == ParserState::CONTENT)
+                    break;
+            } else if (content.size() < BLOCK_SIZE) {
+                // refill content preserving unprocessed
+                if (refill() < 0)
+                    return 1;
+            }
+            TOKEN_START();
+            if (state != ParserState::CONTENT) {
+                // resume the token that the end of the content interrupted
+                if (state == ParserState::START_TAG) {
+                    if (parseAttributes() != 0)
+                        return 1;
+                    if (state == ParserState::CONTENT && depth == 0)
+                        break;
+                } else if (state == ParserState::COMMENT) {
+                    if (parseCommentContent() != 0)
+                        return 1;
+                } else if (parseCDATAContent() != 0) {
+                    return 1;
+                }
+            } else if (content[0] == '&') {
+                // parse character entity references
+                std::string_view unescapedCharacter;
+                std::string_view escapedCharacter;
+                if (content[1] == 'l' && content[2] == 't' && content[3] == ';') {
+                    unescapedCharacter = "<";
+                    escapedCharacter = "&lt;"sv;
+                } else if (content[1] == 'g' && content[2] == 't' && content[3] == ';') {
+                    unescapedCharacter = ">";
+                    escapedCharacter = "&gt;"sv;
+                } else if (content[1] == 'a' && content[2] == 'm' && content[3] == 'p' && content[4] == ';') {
+                    unescapedCharacter = "&";
+                    escapedCharacter = "&amp;"sv;
+                } else {
+                    unescapedCharacter = "&";
+                    escapedCharacter = "&"sv;
+                }
+                assert(content.compare(0, escapedCharacter.size(), escapedCharacter) == 0);
+                trace(TRACE_CHARACTERS, content.substr(0, escapedCharacter.size()));
+                content.remove_prefix(escapedCharacter.size());
+                const std::string_view characters(unescapedCharacter);
+                handler.onCharacters(characters, 0);
+                TOKEN_END(TOKEN_ENTITY);
+            } else if (content[0] != '<') {
+                // parse character non-entity references
+                assert(content[0] != '<' && content[0] != '&');
+                int newlines = 0;
+                std::size_t characterEndPosition = findCharactersEnd(content, newlines);
+                const std::string_view characters(content.substr(0, characterEndPosition));
+                trace(TRACE_CHARACTERS, characters);
+                handler.onCharacters(characters, newlines);
+                content.remove_prefix(characters.size());
+                TOKEN_END(TOKEN_CHARACTERS);
+            } else if (content[1] == '!' /* && content[0] == '<' */ && content[2] == '-' && content[3] == '-') {
+                // parse XML comment
+                assert(content.compare(0, "<!--"sv.size(), "<!--"sv) == 0);
+                content.remove_prefix("<!--"sv.size());
+                state = ParserState::COMMENT;
+                if (parseCommentContent() != 0)
+                    return 1;
+            } else if (content[1] == '!' /* && content[0] == '<' */ && content[2] == '[' && content[3] == 'C' && content[4] == 'D' &&
+                       content[5] == 'A' && content[6] == 'T' && content[7] == 'A' && content[8] == '[') {
+                // parse CDATA
+                content.remove_prefix("<![CDATA["sv.size());
+                state = ParserState::CDATA;
+                if (parseCDATAContent() != 0)
+                    return 1;
+            } else if (content[1] == '?' /* && content[0] == '<' */) {
+                // parse processing instruction
+                assert(content.compare(0, "<?"sv.size(), "<?"sv) == 0);
+                content.remove_prefix("<?"sv.size());
+                std::size_t tagEndPosition = content.find("?>"sv);
+                if (tagEndPosition == content.npos) {
+                    errors << "parser error: Incomplete XML declaration\n";
+                    return 1;
+                }
+                std::size_t nameEndPosition = findNameEnd(content);
+                if (nameEndPosition == content.npos) {
+                    errors << "parser error : Unterminated processing instruction\n";
+                    return 1;
+                }
+                const std::string_view target(content.substr(0, nameEndPosition));
+                const std::string_view data(content.substr(nameEndPosition, tagEndPosition - nameEndPosition));
+                trace(TRACE_PI, content.substr(0, tagEndPosition));
+                handler.onProcessingInstruction(target, data);
+                content.remove_prefix(tagEndPosition);
+                assert(content.compare(0, "?>"sv.size(), "?>"sv) == 0);
+                content.remove_prefix("?>"sv.size());
+                TOKEN_END(TOKEN_PI);
+            } else if (content[1] == '/' /* && content[0] == '<' */) {
+                // parse end tag
+                assert(content.compare(0, "</"sv.size(), "</"sv) == 0);
+                content.remove_prefix("</"sv.size());
+                if (content[0] == ':') {
+                    errors << "parser error : Invalid end tag name\n";
+                    return 1;
+                }
+                std::size_t nameEndPosition = findNameEnd(content);
+                size_t colonPosition = 0;
+                if (nameEndPosition != content.npos && content[nameEndPosition] == ':') {
+                    colonPosition = nameEndPosition;
+                    nameEndPosition = findNameEnd(content, nameEndPosition + 1);
+                }
+                if (nameEndPosition == content.npos) {
+                    errors << "parser error : Unterminated end tag '" << content << "'\n";
+                    return 1;
+                }
+                const std::string_view qName(content.substr(0, nameEndPosition));
+                if (qName.empty()) {
+                    errors << "parser error: EndTag: invalid element name\n";
+                    return 1;
+                }
+                const std::string_view prefix(qName.substr(0, colonPosition));
+                const std::string_view localName(qName.substr(colonPosition ? colonPosition + 1 : 0));
+                trace(TRACE_END_TAG, qName);
+                content.remove_prefix(nameEndPosition);
+                if (!skipWhitespace() || content[0] != '>') {
+                    errors << "parser error : Unterminated end tag '" << qName << "'\n";
+                    return 1;
+                }
+                handler.onEndTag(prefix, qName, localName);
+                content.remove_prefix(">"sv.size());
+                TOKEN_END(TOKEN_END_TAG);
+                --depth;
+                if (depth == 0)
+                    break;
+            } else if (content[0] == '<') {
+                // parse start tag
+                assert(content.compare(0, "<"sv.size(), "<"sv) == 0);
+                content.remove_prefix("<"sv.size());
+                if (content[0] == ':') {
+                    errors << "parser error : Invalid start tag name\n";
+                    return 1;
+                }
+                std::size_t nameEndPosition = findNameEnd(content);
+                size_t colonPosition = 0;
+                if (nameEndPosition != content.npos && content[nameEndPosition] == ':') {
+                    colonPosition = nameEndPosition;
+                    nameEndPosition = findNameEnd(content, nameEndPosition + 1);
+                }
+                if (nameEndPosition == content.npos) {
+                    errors << "parser error : Unterminated start tag '" << content << "'\n";
+                    return 1;
+                }
+                const std::string_view qName(content.substr(0, nameEndPosition));
+                if (qName.empty()) {
+                    errors << "parser error: StartTag: invalid element name\n";
+                    return 1;
+                }
+                const std::string_view prefix(qName.substr(0, colonPosition));
+                const std::string_view localName(qName.substr(colonPosition ? colonPosition + 1 : 0, nameEndPosition));
+                trace(TRACE_START_TAG, qName);
+                handler.onStartTag(prefix, qName, localName);
+                content.remove_prefix(nameEndPosition);
+                skipWhitespace();
+                TOKEN_PAUSE(TOKEN_START_TAG);
+                tagQName = qName;
+                tagColonPosition = colonPosition;
+                state = ParserState::START_TAG;
+                if (parseAttributes() != 0)
+                    return 1;
+                if (state == ParserState::CONTENT && depth == 0)
+                    break;
+            } else {
+                errors << "parser error : invalid XML document\n";
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    /*
+        Parse the attributes and namespaces of the current start tag, and the
+        end of the start tag. When the next attribute may be past the end of
+        the content, the start tag is interrupted, and is resumed after the
+        next refill. An empty element is ended, and the content of an element
+        that the handler skips is skipped.
+
+        @return Status of the parse
+    */
+    int parseAttributes() {
+
+        using namespace std::literals::string_view_literals;
+        while (true) {
+            // suspend when the next attribute may be past the end of the content
+            if (content.size() < BLOCK_SIZE && !doneReading)
+                return 0;
+            if (content.empty() || !isCharacterClass(content[0], NAME_CHAR))
+                break;
+            TOKEN_START();
+            const char* const attributeStart = content.data();
+            if (content[0] == 'x' && content[1] == 'm' && content[2] == 'l' && content[3] == 'n' && content[4] == 's' && (content[5] == ':' || content[5] == '=')) {
+                // parse XML namespace
+                assert(content.compare(0, "xmlns"sv.size(), "xmlns"sv) == 0);
+                content.remove_prefix("xmlns"sv.size());
+                std::size_t nameEndPosition = content.find('=');
+                if (nameEndPosition == content.npos) {
+                    errors << "parser error : incomplete namespace\n";
+                    return 1;
+                }
+                std::size_t prefixSize = 0;
+                if (content[0] == ':') {
+                    content.remove_prefix(":"sv.size());
+                    --nameEndPosition;
+                    prefixSize = nameEndPosition;
+                }
+                std::string_view prefix(content.substr(0, prefixSize));
+                content.remove_prefix(nameEndPosition);
+                content.remove_prefix("="sv.size());
+                skipWhitespace();
+                if (content.empty()) {
+                    errors << "parser error : incomplete namespace\n";
+                    return 1;
+                }
+                const char delimiter = content[0];
+                if (delimiter != '"' && delimiter != '\'') {
+                    errors << "parser error : incomplete namespace\n";
+                    return 1;
+                }
+                content.remove_prefix("\""sv.size());
+                std::size_t valueEndPosition = content.find(delimiter);
+                std::string_view uri;
+                if (valueEndPosition == content.npos && !doneReading) {
+                    // the namespace is saved, since the rest of its value may be larger than a refill preserves
+                    const std::size_t prefixStart = prefix.data() - attributeStart;
+                    const std::size_t valueStart = content.data() - attributeStart;
+                    if (saveAttribute(attributeStart, delimiter) != 0)
+                        return 1;
+                    prefix = std::string_view(savedAttribute).substr(prefixStart, prefix.size());
+                    uri = std::string_view(savedAttribute).substr(valueStart);
+                    valueEndPosition = 0;
+                    if (traceEnabled)
+                        traceEvent(TRACE_NAMESPACE, inputOffset + savedAttributePosition, savedAttribute.size() + "\""sv.size());
+                } else if (valueEndPosition == content.npos) {
+                    errors << "parser error : incomplete namespace\n";
+                    return 1;
+                } else {
+                    uri = content.substr(0, valueEndPosition);
+                    trace(TRACE_NAMESPACE, std::string_view(attributeStart, uri.data() + uri.size() + 1 - attributeStart));
+                }
+                handler.onNamespace(prefix, uri);
+                content.remove_prefix(valueEndPosition);
+                assert(content.compare(0, "\""sv.size(), "\""sv) == 0);
+                content.remove_prefix("\""sv.size());
+                skipWhitespace();
+                TOKEN_END(TOKEN_NAMESPACE);
+            } else {
+                // parse attribute
+                std::size_t nameEndPosition = findNameEnd(content);
+                size_t colonPosition = 0;
+                if (nameEndPosition != content.npos && content[nameEndPosition] == ':') {
+                    colonPosition = nameEndPosition;
+                    nameEndPosition = findNameEnd(content, nameEndPosition + 1);
+                }
+                if (nameEndPosition == content.npos) {
+                    errors << "parser error : Unterminated attribute '" << content << "'\n";
+                    return 1;
+                }
+                std::string_view qName(content.substr(0, nameEndPosition));
+                content.remove_prefix(nameEndPosition);
+                skipWhitespace();
+                if (content.empty()) {
+                    errors << "parser error : attribute " << qName << " incomplete attribute\n";
+                    return 1;
+                }
+                if (content[0] != '=') {
+                    errors << "parser error : attribute " << qName << " missing =\n";
+                    return 1;
+                }
+                content.remove_prefix("="sv.size());
+                skipWhitespace();
+                const char delimiter = content[0];
+                if (delimiter != '"' && delimiter != '\'') {
+                    errors << "parser error : attribute " << qName << " missing delimiter\n";
+                    return 1;
+                }
+                content.remove_prefix("\""sv.size());
+                std::size_t valueEndPosition = content.find(delimiter);
+                std::string_view value;
+                if (valueEndPosition == content.npos && !doneReading) {
+                    // the attribute is saved, since the rest of its value may be larger than a refill preserves
+                    const std::size_t valueStart = content.data() - attributeStart;
+                    if (saveAttribute(attributeStart, delimiter) != 0)
+                        return 1;
+                    qName = std::string_view(savedAttribute).substr(0, qName.size());
+                    value = std::string_view(savedAttribute).substr(valueStart);
+                    valueEndPosition = 0;
+                    if (traceEnabled)
+                        traceEvent(TRACE_ATTRIBUTE, inputOffset + savedAttributePosition, savedAttribute.size() + "\""sv.size());
+                } else if (valueEndPosition == content.npos) {
+                    errors << "parser error : attribute " << qName << " missing delimiter\n";
+                    return 1;
+                } else {
+                    value = content.substr(0, valueEndPosition);
+                    trace(TRACE_ATTRIBUTE, std::string_view(qName.data(), value.data() + value.size() + 1 - qName.data()));
+                }
+                const std::string_view prefix(qName.substr(0, colonPosition));
+                const std::string_view localName(qName.substr(colonPosition ? colonPosition + 1 : 0));
+                handler.onAttribute(prefix, qName, localName, value);
+                content.remove_prefix(valueEndPosition);
+                content.remove_prefix("\""sv.size());
+                skipWhitespace();
+                TOKEN_END(TOKEN_ATTRIBUTE);
+            }
+        }
+        TOKEN_START();
+        if (content.empty()) {
+            errors << "parser error : Unterminated start tag '" << tagQName << "'\n";
+            return 1;
+        }
+        state = ParserState::CONTENT;
+        if (content[0] == '>') {
+            content.remove_prefix(">"sv.size());
+            TOKEN_END(TOKEN_START_TAG);
+            ++depth;
+            if (handler.skipContent() && skipElementContent() != 0)
+                return 1;
+        } else if (content[0] == '/' && content[1] == '>') {
+            assert(content.compare(0, "/>"sv.size(), "/>") == 0);
+            content.remove_prefix("/>"sv.size());
+            const std::string_view prefix(tagQName.substr(0, tagColonPosition));
+            const std::string_view localName(tagQName.substr(tagColonPosition ? tagColonPosition + 1 : 0));
+            if (tagQName.data() != savedTagQName.data())
+                trace(TRACE_END_TAG, tagQName);
+            else if (traceEnabled)
+                traceEvent(TRACE_END_TAG, inputOffset + savedTagPosition, tagQName.size());
+            handler.onEndTag(prefix, tagQName, localName);
+            TOKEN_END(TOKEN_START_TAG);
+        }
+
+        return 0;
+    }
+
+    /*
+        Save an attribute whose value continues past the end of the content,
+        and refill the content until the delimiter that ends the value. The
+        attribute is kept outside of the content, so its size is not limited
+        by the prefix that a refill preserves.
+
+        @param[in] attributeStart Start of the attribute in the content
+        @param[in] delimiter Delimiter that ends the value
+        @return Status of the parse, with the attribute up to the end of its
+            value in savedAttribute, and the content at the delimiter
+    */
+    int saveAttribute(const char* attributeStart, char delimiter) {
+
+        savedAttributePosition = position() + (attributeStart - content.data());
+        savedAttribute.assign(attributeStart, content.data() + content.size() - attributeStart);
+        content.remove_prefix(content.size());
+        std::size_t valueEndPosition = content.npos;
+        while (valueEndPosition == content.npos) {
+            const int bytesRead = refill();
+            if (bytesRead < 0)
+                return 1;
+            if (bytesRead == 0) {
+                errors << "parser error : Unterminated attribute value\n";
+                return 1;
+            }
+            valueEndPosition = content.find(delimiter);
+            const std::string_view part(content.substr(0, valueEndPosition));
+            savedAttribute.append(part);
+            content.remove_prefix(part.size());
+        }
+
+        return 0;
+    }
+
+    /*
+        Parse the rest of a comment, up to and including its end. Without the
+        end in the content, the content, except for the bytes that may start
+        the end, is delivered as part of the comment, and the comment is
+        resumed after the next refill.
+
+        @return Status of the parse
+    */
+    int parseCommentContent() {
+
+        using namespace std::literals::string_view_literals;
+        const std::size_t tagEndPosition = content.find("-->"sv);
+        if (tagEndPosition == content.npos) {
+            if (doneReading) {
+                errors << "parser error : Unterminated XML comment\n";
+                return 1;
+            }
+            const std::string_view comment(content.substr(0, content.size() - std::min(content.size(), "--"sv.size())));
+            if (!comment.empty()) {
+                trace(TRACE_COMMENT, comment);
+                handler.onComment(comment);
+                content.remove_prefix(comment.size());
+            }
+            TOKEN_PAUSE(TOKEN_COMMENT);
+            return 0;
+        }
+        const std::string_view comment(content.substr(0, tagEndPosition));
+        trace(TRACE_COMMENT, comment);
+        handler.onComment(comment);
+        content.remove_prefix(tagEndPosition);
+        content.remove_prefix("-->"sv.size());
+        state = ParserState::CONTENT;
+        TOKEN_END(TOKEN_COMMENT);
+
+        return 0;
+    }
+
+    /*
+        Parse the rest of a CDATA section, up to and including its end.
+        Without the end in the content, the content, except for the bytes
+        that may start the end, is delivered as part of the CDATA section,
+        and the CDATA section is resumed after the next refill.
+
+        @return Status of the parse
+    */
+    int parseCDATAContent() {
+
+        using namespace std::literals::string_view_literals;
+        const std::size_t tagEndPosition = content.find("]]>"sv);
+        if (tagEndPosition == content.npos) {
+            if (doneReading) {
+                errors << "parser error : Unterminated CDATA\n";
+                return 1;
+            }
+            const std::string_view characters(content.substr(0, content.size() - std::min(content.size(), "]]"sv.size())));
+            if (!characters.empty()) {
+                trace(TRACE_CDATA, characters);
+                handler.onCDATA(characters);
+                content.remove_prefix(characters.size());
+            }
+            TOKEN_PAUSE(TOKEN_CDATA);
+            return 0;
+        }
+        const std::string_view characters(content.substr(0, tagEndPosition));
+        trace(TRACE_CDATA, characters);
+        handler.onCDATA(characters);
+        content.remove_prefix(tagEndPosition);
+        content.remove_prefix("]]>"sv.size());
+        state = ParserState::CONTENT;
+        TOKEN_END(TOKEN_CDATA);
+
+        return 0;
+    }
+
+    /*
+        Skip the content of the current element without parsing it, up to
+        its end tag. Only the nesting of tags is counted with findElementEnd(),
+        with comments, CDATA, and processing instructions skipped whole. The
+        end tag is then parsed as usual.
+
+        @return Status of the skip
+    */
+    int skipElementContent() {
+
+        using namespace std::literals::string_view_literals;
+        int nesting = 0;
+        while (true) {
+            const std::size_t markupPosition = findElementEnd(content, nesting);
+            if (markupPosition == content.npos) {
+                if (doneReading) {
+                    errors << "parser error : Unterminated element\n";
+                    return 1;
+                }
+                // refill content preserving the last byte, the context of the next byte
+                content.remove_prefix(content.empty() ? 0 : content.size() - 1);
+                if (refill() < 0)
+                    return 1;
+                continue;
+            }
+            content.remove_prefix(markupPosition);
+            if (content[1] == '/')
+                return 0;
+
+            // skip comment, CDATA, or processing instruction whole
+            if (content.size() < "<![CDATA["sv.size() && !doneReading) {
+                // refill content preserving unprocessed
+                if (refill() < 0)
+                    return 1;
+            }
+            std::string_view markupEnd = ">"sv;
+            if (content.compare(0, "<!--"sv.size(), "<!--"sv) == 0)
+                markupEnd = "-->"sv;
+            else if (content.compare(0, "<![CDATA["sv.size(), "<![CDATA["sv) == 0)
+                markupEnd = "]]>"sv;
+            else if (content[1] == '?')
+                markupEnd = "?>"sv;
+            std::size_t markupEndPosition = content.find(markupEnd, 2);
+            while (markupEndPosition == content.npos && !doneReading) {
+                // refill content preserving only the bytes that may start the end of the markup
+                content.remove_prefix(content.size() - std::min(content.size(), markupEnd.size() - 1));
+                if (refill() < 0)
+                    return 1;
+                markupEndPosition = content.find(markupEnd);
+            }
+            if (markupEndPosition == content.npos) {
+                errors << "parser error : Unterminated element\n";
+                return 1;
+            }
+            content.remove_prefix(markupEndPosition + markupEnd.size());
+        }
+    }
+
+    /*
+        Parse the comments after the root element.
+
+        @return Status of the parse
+    */
+    int parseEpilog() {
+
+        using namespace std::literals::string_view_literals;
+        content.remove_prefix(findNonWhitespace(content) == content.npos ? content.size() : findNonWhitespace(content));
+        while (!content.empty() && content[0] == '<' && content[1] == '!' && content[2] == '-' && content[3] == '-') {
+            // parse XML comment
+            TOKEN_START();
+            assert(content.compare(0, "<!--"sv.size(), "<!--"sv) == 0);
+            content.remove_prefix("<!--"sv.size());
+            state = ParserState::COMMENT;
+            while (true) {
+                if (parseCommentContent() != 0)
+                    return 1;
+                if (state == ParserState::CONTENT)
+                    break;
+                // refill content preserving unprocessed
+                if (refill() < 0)
+                    return 1;
+                TOKEN_START();
+            }
+            content.remove_prefix(findNonWhitespace(content) == content.npos ? content.size() : findNonWhitespace(content));
+        }
+        if (!content.empty()) {
+            errors << "parser error : extra content at end of document\n";
+            return 1;
+        }
+
+        return 0;
+    }
+
+    Handler& handler;
+    // reader of the input, or the standard input when none
+    ContentReader* reader = nullptr;
+    std::string_view content;
+    bool doneReading;
+    long totalBytesRead;
+    // offset of the content in the input
+    long inputOffset;
+    int depth = 0;
+    // token that the end of the content interrupted, resumed after the next refill
+    enum class ParserState { CONTENT, START_TAG, COMMENT, CDATA };
+    ParserState state = ParserState::CONTENT;
+    // name of the current start tag, for the end of an empty element
+    std::string_view tagQName;
+    std::size_t tagColonPosition = 0;
+    // name of an interrupted start tag, and its position, when the refill replaces its content
+    std::string savedTagQName;
+    long savedTagPosition = 0;
+    // attribute with a value that continued past the end of the content, and its position
+    std::string savedAttribute;
+    long savedAttributePosition = 0;
+    // parser errors, standard error unless errors are not reported
+    std::ostream errors{ std::cerr.rdbuf() };
+#ifdef TOKEN_STATS
+    TokenStats tokenStats;
+#endif
+};
+
+#endif
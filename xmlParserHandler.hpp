@@ -0,0 +1,59 @@
+/*
+    xmlParserHandler.hpp
+
+    Base of the handlers of XMLParser with empty callbacks. A handler
+    derives from it, and defines only the callbacks it uses.
+*/
+
+#ifndef INCLUDED_XMLPARSERHANDLER_HPP
+#define INCLUDED_XMLPARSERHANDLER_HPP
+
+#include <string_view>
+#include <optional>
+
+class XMLParserHandler {
+public:
+
+    // start of the document
+    void onStartDocument() {}
+
+    // XML declaration
+    void onXMLDeclaration(std::string_view /* version */, std::optional<std::string_view> /* encoding */,
+                          std::optional<std::string_view> /* standalone */) {}
+
+    // DOCTYPE with its unparsed contents
+    void onDoctype(std::string_view /* contents */) {}
+
+    // start tag, before its namespaces and attributes
+    void onStartTag(std::string_view /* prefix */, std::string_view /* qName */, std::string_view /* localName */) {}
+
+    // end tag, including the end of an empty element
+    void onEndTag(std::string_view /* prefix */, std::string_view /* qName */, std::string_view /* localName */) {}
+
+    // skip the content of the current element to its end tag, checked after its namespaces and attributes
+    bool skipContent() { return false; }
+
+    // namespace declaration of the current start tag
+    void onNamespace(std::string_view /* prefix */, std::string_view /* uri */) {}
+
+    // attribute of the current start tag
+    void onAttribute(std::string_view /* prefix */, std::string_view /* qName */, std::string_view /* localName */,
+                     std::string_view /* value */) {}
+
+    // characters, with the number of newlines in them
+    void onCharacters(std::string_view /* characters */, int /* newlines */) {}
+
+    // XML comment, or consecutive parts of a comment larger than the content of the parser
+    void onComment(std::string_view /* comment */) {}
+
+    // CDATA section, or consecutive parts of a CDATA section larger than the content of the parser
+    void onCDATA(std::string_view /* characters */) {}
+
+    // processing instruction
+    void onProcessingInstruction(std::string_view /* target */, std::string_view /* data */) {}
+
+    // end of the document
+    void onEndDocument() {}
+};
+
+#endif